@@ -0,0 +1,69 @@
+import jowi.generic;
+#include "bench.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace generic = jowi::generic;
+namespace bench = jowi::bench;
+
+/*
+  AtomicStack against a std::vector behind a std::mutex. Every thread pushes a small burst of
+  values and pops as many back, so the stack stays short and every operation contends on its head.
+*/
+struct MutexStack {
+  std::mutex mut;
+  std::vector<uint64_t> values;
+
+  void push(uint64_t v) {
+    std::lock_guard l{mut};
+    values.emplace_back(v);
+  }
+  std::optional<uint64_t> pop() {
+    std::lock_guard l{mut};
+    if (values.empty()) {
+      return std::nullopt;
+    }
+    uint64_t v = values.back();
+    values.pop_back();
+    return v;
+  }
+};
+
+constexpr size_t ops_per_thread = 200'000;
+constexpr size_t burst = 8;
+
+template <class Stack> void bench_stack(std::string_view name, size_t thread_count) {
+  auto d = bench::best_of(3, [&]() {
+    Stack stack;
+    return bench::run_threads(thread_count, [&](size_t t) {
+      uint64_t sum = 0;
+      for (size_t i = 0; i < ops_per_thread; i += burst) {
+        for (size_t j = 0; j < burst; j += 1) {
+          stack.push(t * ops_per_thread + i + j);
+        }
+        for (size_t j = 0; j < burst; j += 1) {
+          sum += stack.pop().value_or(0);
+        }
+      }
+      bench::do_not_optimize(sum);
+    });
+  });
+  // a push and a pop per value.
+  bench::report(name, thread_count, thread_count * ops_per_thread * 2, d);
+}
+
+int main() {
+  for (size_t threads : bench::thread_counts(64)) {
+    bench_stack<generic::AtomicStack<uint64_t, generic::Uint16TaggedPtr>>(
+      "AtomicStack<Uint16TaggedPtr>", threads
+    );
+    bench_stack<generic::AtomicStack<uint64_t, generic::DoubleWordTaggedPtr>>(
+      "AtomicStack<DoubleWordTaggedPtr>", threads
+    );
+    bench_stack<MutexStack>("std::mutex + std::vector", threads);
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <latch>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+  Helpers shared by the benchmarks. Each benchmark is a plain executable timing loops with
+  std::chrono and printing one line per measurement, there is no statistics beyond the best of a
+  few repetitions.
+*/
+namespace jowi::bench {
+  using ClockType = std::chrono::steady_clock;
+
+  // keeps the optimiser from dropping the computation of v.
+  template <class T> inline void do_not_optimize(const T &v) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&v) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &v;
+#endif
+  }
+
+  // 1, 2, 4, ... up to max, max itself is always included.
+  inline std::vector<size_t> thread_counts(size_t max) {
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < max; n *= 2) {
+      counts.emplace_back(n);
+    }
+    counts.emplace_back(max);
+    return counts;
+  }
+  inline size_t hardware_threads() {
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  /*
+    runs body(thread_index) on thread_count threads released at the same time and returns the wall
+    time until the last one is done.
+  */
+  template <class F> ClockType::duration run_threads(size_t thread_count, F &&body) {
+    std::latch ready{static_cast<std::ptrdiff_t>(thread_count + 1)};
+    std::vector<std::jthread> threads;
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i += 1) {
+      threads.emplace_back([&, i]() {
+        ready.arrive_and_wait();
+        body(i);
+      });
+    }
+    ready.arrive_and_wait();
+    auto start = ClockType::now();
+    threads.clear();
+    return ClockType::now() - start;
+  }
+
+  // best of repetitions runs of f, which returns the duration it measured.
+  template <class F> ClockType::duration best_of(size_t repetitions, F &&f) {
+    auto best = ClockType::duration::max();
+    for (size_t i = 0; i < repetitions; i += 1) {
+      best = std::min<ClockType::duration>(best, f());
+    }
+    return best;
+  }
+
+  inline void report(std::string_view name, size_t threads, size_t ops, ClockType::duration d) {
+    double ns = std::chrono::duration<double, std::nano>(d).count();
+    std::printf(
+      "%-36.*s threads=%-3zu %10.2f ns/op %10.2f Mops/s\n",
+      static_cast<int>(name.size()),
+      name.data(),
+      threads,
+      ns / static_cast<double>(ops),
+      static_cast<double>(ops) * 1e3 / ns
+    );
+  }
+}
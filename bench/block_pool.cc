@@ -0,0 +1,90 @@
+import jowi.generic;
+#include "bench.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace generic = jowi::generic;
+namespace bench = jowi::bench;
+
+/*
+  ObjectPool against operator new / delete, and BlockPoolResource against the default
+  memory_resource under a std::pmr::list. Every thread repeatedly allocates a batch of small nodes
+  and frees them again, the allocation heavy pattern the pool is meant for.
+*/
+struct Node {
+  uint64_t key;
+  uint64_t value;
+  Node *next;
+};
+
+constexpr size_t ops_per_thread = 1'000'000;
+constexpr size_t batch = 64;
+
+struct NewDelete {
+  Node *create(uint64_t i) {
+    return new Node{i, i, nullptr};
+  }
+  void destroy(Node *node) {
+    delete node;
+  }
+};
+struct Pooled {
+  generic::ObjectPool<Node> pool;
+
+  Node *create(uint64_t i) {
+    return pool.create(i, i, nullptr);
+  }
+  void destroy(Node *node) {
+    pool.destroy(node);
+  }
+};
+
+template <class Allocator> void bench_nodes(std::string_view name, size_t thread_count) {
+  auto d = bench::best_of(3, [&]() {
+    Allocator allocator;
+    return bench::run_threads(thread_count, [&](size_t) {
+      std::vector<Node *> nodes(batch);
+      for (size_t i = 0; i < ops_per_thread; i += batch) {
+        for (size_t j = 0; j < batch; j += 1) {
+          nodes[j] = allocator.create(i + j);
+        }
+        bench::do_not_optimize(nodes);
+        for (Node *node : nodes) {
+          allocator.destroy(node);
+        }
+      }
+    });
+  });
+  bench::report(name, thread_count, thread_count * ops_per_thread, d);
+}
+
+void bench_pmr_list(std::string_view name, std::pmr::memory_resource *resource) {
+  auto d = bench::best_of(3, [&]() {
+    return bench::run_threads(1, [&](size_t) {
+      std::pmr::list<uint64_t> list{resource};
+      for (size_t i = 0; i < ops_per_thread; i += batch) {
+        for (size_t j = 0; j < batch; j += 1) {
+          list.emplace_back(i + j);
+        }
+        bench::do_not_optimize(list);
+        list.clear();
+      }
+    });
+  });
+  bench::report(name, 1, ops_per_thread, d);
+}
+
+int main() {
+  for (size_t threads : bench::thread_counts(bench::hardware_threads())) {
+    bench_nodes<Pooled>("ObjectPool create/destroy", threads);
+    bench_nodes<NewDelete>("new/delete", threads);
+  }
+  // a list node of uint64_t is two pointers and the value.
+  generic::BlockPoolResource<32> pool_resource;
+  bench_pmr_list("pmr::list on BlockPoolResource", &pool_resource);
+  bench_pmr_list("pmr::list on new_delete_resource", std::pmr::new_delete_resource());
+}
@@ -0,0 +1,94 @@
+import jowi.generic;
+#include "bench.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+
+namespace generic = jowi::generic;
+namespace bench = jowi::bench;
+
+/*
+  Reader scaling of SeqLock and VersionedSnapshot against a std::shared_mutex, from one reader up
+  to every hardware thread. A single writer keeps updating the value while the readers run, only
+  the reads are reported.
+*/
+struct Config {
+  std::array<uint64_t, 8> words;
+};
+
+constexpr size_t reads_per_thread = 2'000'000;
+
+struct SharedMutexConfig {
+  mutable std::shared_mutex mut;
+  Config value{};
+
+  uint64_t read() const {
+    std::shared_lock l{mut};
+    return value.words[0] + value.words[7];
+  }
+  void write(uint64_t v) {
+    std::lock_guard l{mut};
+    value.words.fill(v);
+  }
+};
+struct SeqLockConfig {
+  generic::SeqLock<Config> lock{Config{}};
+
+  uint64_t read() const {
+    Config c = lock.load();
+    return c.words[0] + c.words[7];
+  }
+  void write(uint64_t v) {
+    Config c;
+    c.words.fill(v);
+    lock.store(c);
+  }
+};
+struct SnapshotConfig {
+  generic::VersionedSnapshot<Config> snapshot{Config{}};
+
+  uint64_t read() const {
+    auto guard = snapshot.read();
+    return guard->words[0] + guard->words[7];
+  }
+  void write(uint64_t v) {
+    Config c;
+    c.words.fill(v);
+    snapshot.store(c);
+  }
+};
+
+template <class Shared> void bench_readers(std::string_view name, size_t reader_count) {
+  auto d = bench::best_of(3, [&]() {
+    Shared shared;
+    std::atomic<size_t> readers_done{0};
+    // thread 0 writes until every reader is done.
+    return bench::run_threads(reader_count + 1, [&](size_t t) {
+      if (t == 0) {
+        for (uint64_t v = 1; readers_done.load(std::memory_order_relaxed) != reader_count; v += 1) {
+          shared.write(v);
+        }
+        return;
+      }
+      uint64_t sum = 0;
+      for (size_t i = 0; i < reads_per_thread; i += 1) {
+        sum += shared.read();
+      }
+      bench::do_not_optimize(sum);
+      readers_done.fetch_add(1, std::memory_order_relaxed);
+    });
+  });
+  bench::report(name, reader_count, reader_count * reads_per_thread, d);
+}
+
+int main() {
+  for (size_t readers : bench::thread_counts(bench::hardware_threads())) {
+    bench_readers<SeqLockConfig>("SeqLock load", readers);
+    bench_readers<SnapshotConfig>("VersionedSnapshot read", readers);
+    bench_readers<SharedMutexConfig>("std::shared_mutex read", readers);
+  }
+}
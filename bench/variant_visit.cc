@@ -0,0 +1,76 @@
+import jowi.generic;
+#include "bench.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace generic = jowi::generic;
+namespace bench = jowi::bench;
+
+/*
+  Variant::visit, dispatched through variant_switch, against std::visit on the same std::variant
+  for 2 to 32 alternatives. The visited values are spread uniformly over the alternatives in a
+  pseudo random order so that the branch predictor cannot learn the sequence.
+*/
+template <size_t I> struct Alternative {
+  uint32_t value;
+};
+// every alternative contributes something different, the switch cannot fold the arms.
+struct ScaleByIndex {
+  template <size_t I> uint64_t operator()(const Alternative<I> &a) const {
+    return a.value * (I + 1);
+  }
+};
+
+constexpr size_t value_count = 4096;
+constexpr size_t rounds = 2'000;
+
+template <size_t... Is> void bench_alternatives(std::index_sequence<Is...>) {
+  using StdVariant = std::variant<Alternative<Is>...>;
+  using GenericVariant = generic::Variant<Alternative<Is>...>;
+  constexpr size_t n = sizeof...(Is);
+  constexpr std::array<StdVariant (*)(uint32_t), n> make{+[](uint32_t v) {
+    return StdVariant{std::in_place_index<Is>, Alternative<Is>{v}};
+  }...};
+
+  std::vector<StdVariant> std_values;
+  std::vector<GenericVariant> generic_values;
+  uint32_t state = 12345;
+  for (size_t i = 0; i < value_count; i += 1) {
+    state = state * 1664525u + 1013904223u;
+    StdVariant v = make[(state >> 16) % n](static_cast<uint32_t>(i));
+    generic_values.emplace_back(v);
+    std_values.emplace_back(std::move(v));
+  }
+  auto time_loop = [&](auto &&visit_one) {
+    return bench::best_of(3, [&]() {
+      auto start = bench::ClockType::now();
+      uint64_t sum = 0;
+      for (size_t r = 0; r < rounds; r += 1) {
+        for (size_t i = 0; i < value_count; i += 1) {
+          sum += visit_one(i);
+        }
+      }
+      bench::do_not_optimize(sum);
+      return bench::ClockType::now() - start;
+    });
+  };
+  auto generic_time = time_loop([&](size_t i) { return generic_values[i].visit(ScaleByIndex{}); });
+  auto std_time = time_loop([&](size_t i) { return std::visit(ScaleByIndex{}, std_values[i]); });
+
+  std::string alternatives = " alternatives=" + std::to_string(n);
+  bench::report("Variant::visit" + alternatives, 1, rounds * value_count, generic_time);
+  bench::report("std::visit" + alternatives, 1, rounds * value_count, std_time);
+}
+
+int main() {
+  bench_alternatives(std::make_index_sequence<2>{});
+  bench_alternatives(std::make_index_sequence<4>{});
+  bench_alternatives(std::make_index_sequence<8>{});
+  bench_alternatives(std::make_index_sequence<16>{});
+  bench_alternatives(std::make_index_sequence<32>{});
+}
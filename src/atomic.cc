@@ -1,14 +1,56 @@
 module;
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 export module jowi.generic:atomic;
 
 namespace jowi::generic {
-  export template <class Tag> requires(sizeof(Tag) <= 2)
-  struct TaggedPtr {
+  /*
+    Tagging policies for TaggedPtr.
+    HighBitsTag stores up to 2 bytes of tag in the upper 16 bits of the pointer. This assumes 48 bit
+    virtual addresses, with 5 level paging (LA57) user space addresses can be wider than that.
+    LowBitsTag stores log2(Alignment) bits of tag in the alignment bits of the pointer, every
+    pointer has to be aligned to Alignment. It works with any address width but the counter wraps
+    quickly.
+    DoubleWordTag stores the full pointer next to an up to 8 byte tag and relies on a 16 byte
+    compare exchange (cmpxchg16b on x86_64), a 64 bit counter never wraps in practice.
+  */
+  export struct HighBitsTag {
+    static constexpr size_t required_alignment = 1;
+  };
+  export template <size_t Alignment> requires(std::has_single_bit(Alignment) && Alignment > 1)
+  struct LowBitsTag {
+    static constexpr size_t required_alignment = Alignment;
+  };
+  export struct DoubleWordTag {
+    static constexpr size_t required_alignment = 1;
+  };
+
+  export template <class Tag, class Policy = HighBitsTag> struct TaggedPtr;
+
+  template <class Tag> requires(sizeof(Tag) <= 2)
+  struct TaggedPtr<Tag, HighBitsTag> {
+    using TagType = Tag;
+    static constexpr size_t required_alignment = HighBitsTag::required_alignment;
     uint64_t raw_value;
 
     std::pair<void *, Tag> to_pair() const noexcept {
@@ -44,11 +86,16 @@ namespace jowi::generic {
       return 0xFFFF'0000'0000'0000;
     }
 
+    // false when the address does not fit in bit_pointer_size() bits.
+    static bool can_hold(const void *ptr) noexcept {
+      return (reinterpret_cast<uint64_t>(ptr) & tag_mask()) == 0;
+    }
+
     static constexpr TaggedPtr from_pair(const void *ptr, Tag tag) noexcept {
       TaggedPtr p{0};
       std::memcpy(static_cast<void *>(&p.raw_value), static_cast<const void *>(&tag), sizeof(Tag));
       p.raw_value = p.raw_value << bit_pointer_size();
-      p.raw_value = p.raw_value | reinterpret_cast<uint64_t>(ptr) & pointer_mask();
+      p.raw_value = p.raw_value | (reinterpret_cast<uint64_t>(ptr) & pointer_mask());
       return p;
     }
 
@@ -57,9 +104,113 @@ namespace jowi::generic {
     }
     static constexpr TaggedPtr null_tag(void *ptr) {
       TaggedPtr p{0};
-      p.raw_value = p.raw_value | reinterpret_cast<uint64_t>(ptr) & pointer_mask();
+      p.raw_value = p.raw_value | (reinterpret_cast<uint64_t>(ptr) & pointer_mask());
+      return p;
+    }
+  };
+
+  template <std::unsigned_integral Tag, size_t Alignment>
+  struct TaggedPtr<Tag, LowBitsTag<Alignment>> {
+    using TagType = Tag;
+    static constexpr size_t required_alignment = Alignment;
+    uint64_t raw_value;
+
+    std::pair<void *, Tag> to_pair() const noexcept {
+      return std::pair{raw_ptr(), tag()};
+    }
+
+    void *raw_ptr() const noexcept {
+      return reinterpret_cast<void *>(raw_value & pointer_mask());
+    }
+
+    // Only the lowest bit_tag_size() bits of the tag are kept.
+    Tag tag() const noexcept {
+      return static_cast<Tag>(raw_value & tag_mask());
+    }
+
+    friend constexpr bool operator==(const TaggedPtr &l, const TaggedPtr &r) {
+      return l.raw_value == r.raw_value;
+    }
+
+    static consteval size_t bit_tag_size() {
+      return std::countr_zero(Alignment);
+    }
+
+    static consteval uint64_t tag_mask() {
+      return Alignment - 1;
+    }
+
+    static consteval uint64_t pointer_mask() {
+      return ~tag_mask();
+    }
+
+    // false when the pointer is not aligned to Alignment.
+    static bool can_hold(const void *ptr) noexcept {
+      return (reinterpret_cast<uint64_t>(ptr) & tag_mask()) == 0;
+    }
+
+    static constexpr TaggedPtr from_pair(const void *ptr, Tag tag) noexcept {
+      return TaggedPtr{(reinterpret_cast<uint64_t>(ptr) & pointer_mask()) | (tag & tag_mask())};
+    }
+
+    static constexpr TaggedPtr null() noexcept {
+      return TaggedPtr{0};
+    }
+    static constexpr TaggedPtr null_tag(void *ptr) {
+      return from_pair(ptr, 0);
+    }
+  };
+
+  template <class Tag> requires(sizeof(Tag) <= 8 && std::is_trivially_copyable_v<Tag>)
+  struct TaggedPtr<Tag, DoubleWordTag> {
+    using TagType = Tag;
+    static constexpr size_t required_alignment = DoubleWordTag::required_alignment;
+    struct alignas(16) RawValue {
+      uint64_t ptr;
+      uint64_t tag;
+
+      friend constexpr bool operator==(const RawValue &l, const RawValue &r) = default;
+    };
+    RawValue raw_value;
+
+    std::pair<void *, Tag> to_pair() const noexcept {
+      return std::pair{raw_ptr(), tag()};
+    }
+
+    void *raw_ptr() const noexcept {
+      return reinterpret_cast<void *>(raw_value.ptr);
+    }
+
+    Tag tag() const noexcept {
+      Tag tag;
+      std::memcpy(
+        static_cast<void *>(&tag), static_cast<const void *>(&raw_value.tag), sizeof(Tag)
+      );
+      return tag;
+    }
+
+    friend constexpr bool operator==(const TaggedPtr &l, const TaggedPtr &r) {
+      return l.raw_value == r.raw_value;
+    }
+
+    static bool can_hold(const void *) noexcept {
+      return true;
+    }
+
+    static constexpr TaggedPtr from_pair(const void *ptr, Tag tag) noexcept {
+      TaggedPtr p{RawValue{reinterpret_cast<uint64_t>(ptr), 0}};
+      std::memcpy(
+        static_cast<void *>(&p.raw_value.tag), static_cast<const void *>(&tag), sizeof(Tag)
+      );
       return p;
     }
+
+    static constexpr TaggedPtr null() noexcept {
+      return TaggedPtr{RawValue{0, 0}};
+    }
+    static constexpr TaggedPtr null_tag(void *ptr) {
+      return TaggedPtr{RawValue{reinterpret_cast<uint64_t>(ptr), 0}};
+    }
   };
 
   template struct TaggedPtr<bool>;
@@ -67,23 +218,129 @@ namespace jowi::generic {
 
   export using BoolTaggedPtr = TaggedPtr<bool>;
   export using Uint16TaggedPtr = TaggedPtr<uint16_t>;
+  export using DoubleWordTaggedPtr = TaggedPtr<uint64_t, DoubleWordTag>;
+
+  /*
+    Head pointer used by the lock free structures below. Hosts with addresses above 2^48 should
+    build with JOWI_GENERIC_DOUBLE_WORD_TAGS, which switches every structure to a full pointer and a
+    64 bit ABA counter.
+  */
+#ifdef JOWI_GENERIC_DOUBLE_WORD_TAGS
+  export using DefaultTaggedPtr = DoubleWordTaggedPtr;
+#else
+  export using DefaultTaggedPtr = Uint16TaggedPtr;
+#endif
+
+  template <class T>
+  concept IsSingleWordTaggedPtr = std::same_as<decltype(T::raw_value), uint64_t>;
+
+  template <size_t Size> struct UintOfSize;
+  template <> struct UintOfSize<1> {
+    using type = uint8_t;
+  };
+  template <> struct UintOfSize<2> {
+    using type = uint16_t;
+  };
+  template <> struct UintOfSize<4> {
+    using type = uint32_t;
+  };
+  template <> struct UintOfSize<8> {
+    using type = uint64_t;
+  };
+
+  template <class T>
+  concept IsPackableField =
+    std::is_trivially_copyable_v<T> && requires { typename UintOfSize<sizeof(T)>::type; };
 
-  export template <class... Args> requires((sizeof(Args) + ...) <= 8)
+  /*
+    PackedByte
+    a record of up to 8 bytes of trivially copyable fields (integers, enums, bools, small structs)
+    packed into a single uint64_t. Fields are laid out from the least significant bit in declaration
+    order, get and set reduce to a shift and a mask. std::atomic<PackedByte> updates every field
+    together with a single 64 bit compare exchange.
+  */
+  export template <IsPackableField... Args> requires((sizeof(Args) + ...) <= 8)
   struct PackedByte {
+    static constexpr size_t field_count = sizeof...(Args);
+    template <size_t I> using FieldType = std::tuple_element_t<I, std::tuple<Args...>>;
+
     uint64_t raw_value;
+
+    template <size_t I> requires(I < field_count)
+    static consteval size_t bit_offset() {
+      constexpr size_t sizes[] = {sizeof(Args)...};
+      size_t offset = 0;
+      for (size_t i = 0; i < I; i += 1) {
+        offset += sizes[i] * 8;
+      }
+      return offset;
+    }
+
+    template <size_t I> requires(I < field_count)
+    static consteval size_t bit_size() {
+      return sizeof(FieldType<I>) * 8;
+    }
+
+    template <size_t I> requires(I < field_count)
+    static consteval uint64_t field_mask() {
+      uint64_t mask = bit_size<I>() == 64 ? ~uint64_t{0} : (uint64_t{1} << bit_size<I>()) - 1;
+      return mask << bit_offset<I>();
+    }
+
+    // true when the field occupies the most significant bits, carries out of it leave the word.
+    template <size_t I> requires(I < field_count)
+    static consteval bool is_top_field() {
+      return bit_offset<I>() + bit_size<I>() == 64;
+    }
+
+    template <size_t I> requires(I < field_count)
+    static constexpr uint64_t encode(FieldType<I> value) noexcept {
+      using UintType = typename UintOfSize<sizeof(FieldType<I>)>::type;
+      return static_cast<uint64_t>(std::bit_cast<UintType>(value)) << bit_offset<I>();
+    }
+
+    template <size_t I> requires(I < field_count)
+    constexpr FieldType<I> get() const noexcept {
+      using UintType = typename UintOfSize<sizeof(FieldType<I>)>::type;
+      return std::bit_cast<FieldType<I>>(static_cast<UintType>(raw_value >> bit_offset<I>()));
+    }
+
+    template <size_t I> requires(I < field_count)
+    constexpr void set(FieldType<I> value) noexcept {
+      raw_value = (raw_value & ~field_mask<I>()) | encode<I>(value);
+    }
+
+    // copy of this record with field I replaced, convenient inside fetch_update.
+    template <size_t I> requires(I < field_count)
+    constexpr PackedByte with(FieldType<I> value) const noexcept {
+      PackedByte p{raw_value};
+      p.template set<I>(value);
+      return p;
+    }
+
+    static constexpr PackedByte from_fields(Args... args) noexcept {
+      return [&]<size_t... Is>(std::index_sequence<Is...>) {
+        return PackedByte{(encode<Is>(args) | ... | uint64_t{0})};
+      }(std::index_sequence_for<Args...>{});
+    }
+
+    friend constexpr bool operator==(const PackedByte &l, const PackedByte &r) = default;
   };
 }
 
 namespace generic = jowi::generic;
 
-template <class Tag> requires(sizeof(Tag) <= 2)
-struct std::atomic<generic::TaggedPtr<Tag>> {
+template <class Tag, class Policy>
+requires(generic::IsSingleWordTaggedPtr<generic::TaggedPtr<Tag, Policy>>)
+struct std::atomic<generic::TaggedPtr<Tag, Policy>> {
 private:
   std::atomic<uint64_t> __v;
 
-  using TaggedPtr = generic::TaggedPtr<Tag>;
+  using TaggedPtr = generic::TaggedPtr<Tag, Policy>;
 
 public:
+  static constexpr bool is_always_lock_free = std::atomic<uint64_t>::is_always_lock_free;
+
   atomic(TaggedPtr v) : __v{v.raw_value} {}
 
   TaggedPtr load(std::memory_order m = std::memory_order_seq_cst) const noexcept {
@@ -115,4 +372,1175 @@ public:
   ) noexcept {
     return __v.compare_exchange_strong(e.raw_value, d.raw_value, s, f);
   }
-};
\ No newline at end of file
+};
+
+/*
+  The double word atomic uses the __sync builtins when the target has a 16 byte compare exchange
+  (-mcx16 on x86_64), those are always inlined as cmpxchg16b. Otherwise it falls back to
+  std::atomic, which may need libatomic. The __sync builtins are full barriers, the memory orders
+  are accepted for interface compatibility only.
+*/
+template <class Tag> struct std::atomic<generic::TaggedPtr<Tag, generic::DoubleWordTag>> {
+private:
+  using TaggedPtr = generic::TaggedPtr<Tag, generic::DoubleWordTag>;
+  using RawValue = typename TaggedPtr::RawValue;
+
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+  using WordType = unsigned __int128;
+  alignas(16) mutable WordType __v;
+
+  static WordType __to_word(const RawValue &v) noexcept {
+    return std::bit_cast<WordType>(v);
+  }
+  static TaggedPtr __from_word(WordType v) noexcept {
+    return TaggedPtr{std::bit_cast<RawValue>(v)};
+  }
+
+public:
+  static constexpr bool is_always_lock_free = true;
+
+  atomic(TaggedPtr v) : __v{__to_word(v.raw_value)} {}
+
+  TaggedPtr load(std::memory_order = std::memory_order_seq_cst) const noexcept {
+    // A compare exchange that never changes the value is the only atomic 16 byte load.
+    return __from_word(__sync_val_compare_and_swap(&__v, WordType{0}, WordType{0}));
+  }
+
+  void store(TaggedPtr v, std::memory_order m = std::memory_order_seq_cst) noexcept {
+    exchange(v, m);
+  }
+
+  TaggedPtr exchange(TaggedPtr v, std::memory_order = std::memory_order_seq_cst) noexcept {
+    TaggedPtr e = load();
+    while (!compare_exchange_strong(e, v)) {
+    }
+    return e;
+  }
+
+  bool compare_exchange_weak(
+    TaggedPtr &e,
+    TaggedPtr d,
+    std::memory_order s = std::memory_order_seq_cst,
+    std::memory_order f = std::memory_order_seq_cst
+  ) noexcept {
+    return compare_exchange_strong(e, d, s, f);
+  }
+
+  bool compare_exchange_strong(
+    TaggedPtr &e,
+    TaggedPtr d,
+    std::memory_order = std::memory_order_seq_cst,
+    std::memory_order = std::memory_order_seq_cst
+  ) noexcept {
+    WordType expected = __to_word(e.raw_value);
+    WordType previous = __sync_val_compare_and_swap(&__v, expected, __to_word(d.raw_value));
+    if (previous == expected) {
+      return true;
+    }
+    e = __from_word(previous);
+    return false;
+  }
+#else
+  std::atomic<RawValue> __v;
+
+public:
+  static constexpr bool is_always_lock_free = std::atomic<RawValue>::is_always_lock_free;
+
+  atomic(TaggedPtr v) : __v{v.raw_value} {}
+
+  TaggedPtr load(std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return TaggedPtr{__v.load(m)};
+  }
+
+  void store(TaggedPtr v, std::memory_order m = std::memory_order_seq_cst) noexcept {
+    __v.store(v.raw_value, m);
+  }
+
+  TaggedPtr exchange(TaggedPtr v, std::memory_order m = std::memory_order_seq_cst) noexcept {
+    return TaggedPtr{__v.exchange(v.raw_value, m)};
+  }
+
+  bool compare_exchange_weak(
+    TaggedPtr &e,
+    TaggedPtr d,
+    std::memory_order s = std::memory_order_seq_cst,
+    std::memory_order f = std::memory_order_seq_cst
+  ) noexcept {
+    return __v.compare_exchange_weak(e.raw_value, d.raw_value, s, f);
+  }
+
+  bool compare_exchange_strong(
+    TaggedPtr &e,
+    TaggedPtr d,
+    std::memory_order s = std::memory_order_seq_cst,
+    std::memory_order f = std::memory_order_seq_cst
+  ) noexcept {
+    return __v.compare_exchange_strong(e.raw_value, d.raw_value, s, f);
+  }
+#endif
+};
+
+/*
+  Atomic PackedByte, every operation works on the whole word. fetch_update and the field wise
+  fetch_add / fetch_sub return the record as it was before the update.
+*/
+template <class... Args> struct std::atomic<generic::PackedByte<Args...>> {
+private:
+  std::atomic<uint64_t> __v;
+
+  using PackedByte = generic::PackedByte<Args...>;
+  template <size_t I> using FieldType = typename PackedByte::template FieldType<I>;
+
+public:
+  static constexpr bool is_always_lock_free = std::atomic<uint64_t>::is_always_lock_free;
+
+  atomic(PackedByte v) : __v{v.raw_value} {}
+
+  PackedByte load(std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return PackedByte{__v.load(m)};
+  }
+
+  void store(PackedByte v, std::memory_order m = std::memory_order_seq_cst) noexcept {
+    __v.store(v.raw_value, m);
+  }
+
+  PackedByte exchange(PackedByte v, std::memory_order m = std::memory_order_seq_cst) noexcept {
+    return PackedByte{__v.exchange(v.raw_value, m)};
+  }
+
+  bool compare_exchange_weak(
+    PackedByte &e,
+    PackedByte d,
+    std::memory_order s = std::memory_order_seq_cst,
+    std::memory_order f = std::memory_order_seq_cst
+  ) noexcept {
+    return __v.compare_exchange_weak(e.raw_value, d.raw_value, s, f);
+  }
+
+  bool compare_exchange_strong(
+    PackedByte &e,
+    PackedByte d,
+    std::memory_order s = std::memory_order_seq_cst,
+    std::memory_order f = std::memory_order_seq_cst
+  ) noexcept {
+    return __v.compare_exchange_strong(e.raw_value, d.raw_value, s, f);
+  }
+
+  /*
+    Replaces the record with f(current) through a compare exchange loop, f may run more than once
+    and should not have side effects.
+  */
+  template <std::invocable<PackedByte> F>
+  requires(std::same_as<std::invoke_result_t<F, PackedByte>, PackedByte>)
+  PackedByte fetch_update(
+    F &&f,
+    std::memory_order s = std::memory_order_seq_cst,
+    std::memory_order fail = std::memory_order_relaxed
+  ) noexcept(std::is_nothrow_invocable_v<F, PackedByte>) {
+    uint64_t current = __v.load(fail);
+    while (!__v.compare_exchange_weak(current, f(PackedByte{current}).raw_value, s, fail)) {
+    }
+    return PackedByte{current};
+  }
+
+  /*
+    Adds delta to the integral field I, wrapping within the field. The top field is updated with a
+    single fetch_add since its carry falls off the word, every other field goes through
+    fetch_update. Place counters last to get the single instruction path.
+  */
+  template <size_t I>
+  requires(std::integral<FieldType<I>> && !std::same_as<FieldType<I>, bool>)
+  PackedByte fetch_add(
+    FieldType<I> delta, std::memory_order m = std::memory_order_seq_cst
+  ) noexcept {
+    if constexpr (PackedByte::template is_top_field<I>()) {
+      return PackedByte{__v.fetch_add(PackedByte::template encode<I>(delta), m)};
+    } else {
+      return fetch_update(
+        [delta](PackedByte p) {
+          return p.template with<I>(static_cast<FieldType<I>>(p.template get<I>() + delta));
+        },
+        m
+      );
+    }
+  }
+
+  template <size_t I>
+  requires(std::integral<FieldType<I>> && !std::same_as<FieldType<I>, bool>)
+  PackedByte fetch_sub(
+    FieldType<I> delta, std::memory_order m = std::memory_order_seq_cst
+  ) noexcept {
+    if constexpr (PackedByte::template is_top_field<I>()) {
+      return PackedByte{__v.fetch_sub(PackedByte::template encode<I>(delta), m)};
+    } else {
+      return fetch_update(
+        [delta](PackedByte p) {
+          return p.template with<I>(static_cast<FieldType<I>>(p.template get<I>() - delta));
+        },
+        m
+      );
+    }
+  }
+};
+
+namespace jowi::generic {
+  template <class NodeType>
+  concept IsAtomicNode = requires(NodeType &node) {
+    { node.next } -> std::same_as<std::atomic<NodeType *> &>;
+  };
+
+  /*
+    AtomicIntrusiveStack
+    lock free (Treiber) stack of caller owned nodes linked through an std::atomic<NodeType *> next
+    member. The head is a TaggedPtr (HeadType, see DefaultTaggedPtr) whose tag is bumped on every
+    successful push and pop, a head that was popped and pushed back in between is therefore not
+    mistaken for the same head (ABA). A popped node may still be read by a thread that lost the race
+    for it, so nodes must stay allocated for as long as the stack is in use, recycle them through an
+    AtomicFreeList instead of freeing them.
+  */
+  export template <IsAtomicNode NodeType, class HeadType = DefaultTaggedPtr>
+  requires(alignof(NodeType) >= HeadType::required_alignment)
+  class AtomicIntrusiveStack {
+    using TagType = typename HeadType::TagType;
+    std::atomic<HeadType> __head;
+
+    static HeadType __next_head(NodeType *node, HeadType head) noexcept {
+      return HeadType::from_pair(node, static_cast<TagType>(head.tag() + 1));
+    }
+
+  public:
+    AtomicIntrusiveStack() noexcept : __head{HeadType::null()} {}
+    AtomicIntrusiveStack(const AtomicIntrusiveStack &) = delete;
+    AtomicIntrusiveStack &operator=(const AtomicIntrusiveStack &) = delete;
+
+    void push(NodeType *node) noexcept {
+      push_chain(node, node);
+    }
+    /*
+      Pushes a chain of nodes, already linked from first to last through next, with a single
+      compare exchange.
+    */
+    void push_chain(NodeType *first, NodeType *last) noexcept {
+      HeadType head = __head.load(std::memory_order_relaxed);
+      do {
+        last->next.store(static_cast<NodeType *>(head.raw_ptr()), std::memory_order_relaxed);
+      } while (!__head.compare_exchange_weak(
+        head, __next_head(first, head), std::memory_order_release, std::memory_order_relaxed
+      ));
+    }
+
+    NodeType *pop() noexcept {
+      HeadType head = __head.load(std::memory_order_acquire);
+      while (head.raw_ptr() != nullptr) {
+        NodeType *node = static_cast<NodeType *>(head.raw_ptr());
+        NodeType *next = node->next.load(std::memory_order_relaxed);
+        if (__head.compare_exchange_weak(
+              head, __next_head(next, head), std::memory_order_acquire, std::memory_order_acquire
+            )) {
+          return node;
+        }
+      }
+      return nullptr;
+    }
+
+    bool empty() const noexcept {
+      return __head.load(std::memory_order_relaxed).raw_ptr() == nullptr;
+    }
+  };
+
+  /*
+    AtomicFreeList
+    multi producer, multi consumer list of reusable nodes. acquire hands out a recycled node or
+    allocates a new one, release gives it back. Nodes are only deleted when the free list is
+    destroyed, every acquired node has to be released by then.
+  */
+  export template <IsAtomicNode NodeType, class HeadType = DefaultTaggedPtr> class AtomicFreeList {
+    AtomicIntrusiveStack<NodeType, HeadType> __nodes;
+
+  public:
+    AtomicFreeList() noexcept = default;
+
+    NodeType *acquire() {
+      if (NodeType *node = __nodes.pop(); node != nullptr) {
+        return node;
+      }
+      return new NodeType{};
+    }
+    NodeType *try_acquire() noexcept {
+      return __nodes.pop();
+    }
+    void release(NodeType *node) noexcept {
+      __nodes.push(node);
+    }
+
+    ~AtomicFreeList() {
+      while (NodeType *node = __nodes.pop()) {
+        delete node;
+      }
+    }
+  };
+
+  /*
+    AtomicStack
+    lock free LIFO of values for any number of producers and consumers. Nodes are recycled through
+    an AtomicFreeList, once the stack has reached its peak size push and pop no longer allocate.
+  */
+  export template <class ValueType, class HeadType = DefaultTaggedPtr> class AtomicStack {
+    static constexpr size_t node_alignment = std::max({
+      HeadType::required_alignment,
+      alignof(std::optional<ValueType>),
+      alignof(std::atomic<void *>),
+    });
+    struct alignas(node_alignment) Node {
+      std::atomic<Node *> next;
+      std::optional<ValueType> value;
+    };
+    AtomicIntrusiveStack<Node, HeadType> __values;
+    AtomicFreeList<Node, HeadType> __free;
+
+  public:
+    AtomicStack() noexcept = default;
+
+    template <class... Args> requires(std::constructible_from<ValueType, Args...>)
+    void emplace(Args &&...args) {
+      Node *node = __free.acquire();
+      try {
+        node->value.emplace(std::forward<Args>(args)...);
+      } catch (...) {
+        __free.release(node);
+        throw;
+      }
+      __values.push(node);
+    }
+    void push(ValueType v) {
+      emplace(std::move(v));
+    }
+
+    std::optional<ValueType> pop() {
+      Node *node = __values.pop();
+      if (node == nullptr) {
+        return std::nullopt;
+      }
+      std::optional<ValueType> v{std::move(node->value)};
+      node->value.reset();
+      __free.release(node);
+      return v;
+    }
+
+    bool empty() const noexcept {
+      return __values.empty();
+    }
+
+    ~AtomicStack() {
+      while (Node *node = __values.pop()) {
+        delete node;
+      }
+    }
+  };
+
+  /*
+    Size used to keep independently written atomics on separate cache lines.
+    std::hardware_destructive_interference_size is not ABI stable, so it is fixed here.
+  */
+  export inline constexpr size_t cache_line_size = 64;
+
+  /*
+    RingQueue
+    bounded FIFO over a power of two ring of slots. Every slot carries a sequence number telling
+    whether it is ready to be written or read for the current lap (Vyukov's bounded queue), so
+    producers and consumers only contend on the head and tail counters which live on their own
+    cache lines. MultiProducer and MultiConsumer select at compile time whether claiming a position
+    needs a compare exchange (multiple threads) or a plain store (a single thread on that side),
+    see SpscRingQueue and MpscRingQueue.
+    The try_ functions never block, they return false, nullopt or a short count when the queue is
+    full or empty.
+  */
+  export template <class ValueType, bool MultiProducer = true, bool MultiConsumer = true>
+  requires(std::is_nothrow_move_constructible_v<ValueType>)
+  class RingQueue {
+    struct Slot {
+      std::atomic<size_t> seq;
+      alignas(ValueType) std::byte storage[sizeof(ValueType)];
+
+      ValueType *address() noexcept {
+        return reinterpret_cast<ValueType *>(storage);
+      }
+      ValueType *value() noexcept {
+        return std::launder(address());
+      }
+    };
+
+    std::unique_ptr<Slot[]> __slots;
+    size_t __mask;
+    alignas(cache_line_size) std::atomic<size_t> __tail;
+    // The alignment also pads the queue itself, nothing else can share the head cache line.
+    alignas(cache_line_size) std::atomic<size_t> __head;
+
+    /*
+      Claims up to n consecutive positions on one side of the queue. A position is ready when its
+      slot sequence equals position + offset (0 for producers, 1 for consumers). Returns the first
+      claimed position and the number of positions claimed.
+    */
+    template <bool Multi>
+    std::pair<size_t, size_t> __claim(std::atomic<size_t> &counter, size_t offset, size_t n) {
+      size_t pos = counter.load(std::memory_order_relaxed);
+      while (true) {
+        size_t ready = 0;
+        while (ready < n &&
+               __slots[(pos + ready) & __mask].seq.load(std::memory_order_acquire) ==
+                 pos + ready + offset) {
+          ready += 1;
+        }
+        if (ready == 0) {
+          if constexpr (Multi) {
+            // Another thread may have claimed pos already, only give up if the counter agrees.
+            size_t current = counter.load(std::memory_order_relaxed);
+            if (current != pos) {
+              pos = current;
+              continue;
+            }
+          }
+          return {pos, 0};
+        }
+        if constexpr (Multi) {
+          if (counter.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+            return {pos, ready};
+          }
+        } else {
+          counter.store(pos + ready, std::memory_order_relaxed);
+          return {pos, ready};
+        }
+      }
+    }
+
+    // destroys the value at a claimed consumer position and hands its slot to the producers.
+    void __release_popped(size_t pos) noexcept {
+      Slot &slot = __slots[pos & __mask];
+      std::destroy_at(slot.value());
+      slot.seq.store(pos + __mask + 1, std::memory_order_release);
+    }
+
+  public:
+    using value_type = ValueType;
+
+    /*
+      capacity is rounded up to the next power of two.
+    */
+    explicit RingQueue(size_t capacity) :
+      __slots{std::make_unique<Slot[]>(std::bit_ceil(std::max<size_t>(capacity, 2)))},
+      __mask{std::bit_ceil(std::max<size_t>(capacity, 2)) - 1}, __tail{0}, __head{0} {
+      for (size_t i = 0; i <= __mask; i += 1) {
+        __slots[i].seq.store(i, std::memory_order_relaxed);
+      }
+    }
+    RingQueue(const RingQueue &) = delete;
+    RingQueue &operator=(const RingQueue &) = delete;
+
+    template <class... Args> requires(std::constructible_from<ValueType, Args...>)
+    bool try_emplace(Args &&...args) {
+      // Constructed up front, a throwing constructor must not leave a claimed slot behind.
+      ValueType v(std::forward<Args>(args)...);
+      auto [pos, n] = __claim<MultiProducer>(__tail, 0, 1);
+      if (n == 0) {
+        return false;
+      }
+      Slot &slot = __slots[pos & __mask];
+      std::construct_at(slot.address(), std::move(v));
+      slot.seq.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+    bool try_push(ValueType v) {
+      return try_emplace(std::move(v));
+    }
+    /*
+      Moves a prefix of values into the queue with a single claim on the tail. Returns the number of
+      values pushed.
+    */
+    size_t try_push_n(std::span<ValueType> values) {
+      auto [pos, n] = __claim<MultiProducer>(__tail, 0, values.size());
+      for (size_t i = 0; i < n; i += 1) {
+        Slot &slot = __slots[(pos + i) & __mask];
+        std::construct_at(slot.address(), std::move(values[i]));
+        slot.seq.store(pos + i + 1, std::memory_order_release);
+      }
+      return n;
+    }
+
+    std::optional<ValueType> try_pop() {
+      auto [pos, n] = __claim<MultiConsumer>(__head, 1, 1);
+      if (n == 0) {
+        return std::nullopt;
+      }
+      Slot &slot = __slots[pos & __mask];
+      std::optional<ValueType> v{std::move(*slot.value())};
+      __release_popped(pos);
+      return v;
+    }
+    /*
+      Pops up to n values with a single claim on the head and writes them to out in FIFO order.
+      Returns the number of values popped. Moving a value cannot throw, but writing it to out can (a
+      back_inserter growing its container), the values left in the claimed positions are then
+      destroyed and their slots handed back to the producers before rethrowing.
+    */
+    template <std::output_iterator<ValueType> Iterator> size_t try_pop_n(Iterator out, size_t n) {
+      auto [pos, claimed] = __claim<MultiConsumer>(__head, 1, n);
+      size_t i = 0;
+      try {
+        for (; i < claimed; i += 1) {
+          Slot &slot = __slots[(pos + i) & __mask];
+          *out = std::move(*slot.value());
+          ++out;
+          __release_popped(pos + i);
+        }
+      } catch (...) {
+        for (; i < claimed; i += 1) {
+          __release_popped(pos + i);
+        }
+        throw;
+      }
+      return claimed;
+    }
+
+    size_t capacity() const noexcept {
+      return __mask + 1;
+    }
+    /*
+      Only exact when no other thread is pushing or popping.
+    */
+    size_t size() const noexcept {
+      size_t tail = __tail.load(std::memory_order_acquire);
+      size_t head = __head.load(std::memory_order_acquire);
+      return tail > head ? tail - head : 0;
+    }
+    bool empty() const noexcept {
+      return size() == 0;
+    }
+
+    ~RingQueue() {
+      while (try_pop()) {
+      }
+    }
+  };
+
+  export template <class ValueType> using SpscRingQueue = RingQueue<ValueType, false, false>;
+  export template <class ValueType> using MpscRingQueue = RingQueue<ValueType, true, false>;
+
+  /*
+    BlockPool
+    allocator for blocks of Size bytes aligned to Align. Memory is carved out of slabs of
+    slab_size blocks and never returned to the system before the pool is gone. Every thread keeps
+    a magazine of up to magazine_size free blocks, allocate and deallocate only touch that
+    magazine. An empty magazine is refilled with half a magazine from a global lock free list
+    (an AtomicIntrusiveStack on DefaultTaggedPtr) or a new slab, a full one drains half of its
+    blocks back to that list with a single compare exchange.
+    Magazines hold a reference to the shared state of the pool, blocks cached by other threads stay
+    valid until those threads exit, after which the slabs are freed.
+  */
+  export template <size_t Size, size_t Align = alignof(std::max_align_t)>
+  requires(std::has_single_bit(Align))
+  class BlockPool {
+    /*
+      the link of the global free list overlaps the storage, it is only alive while the block is
+      free. A block is therefore never larger than Size unless Size is smaller than a pointer. A
+      thread losing a pop race may read the link of a block that was just handed out, the tag of
+      the free list head makes it discard what it read.
+    */
+    struct Block {
+      union {
+        alignas(Align) std::byte storage[std::max(Size, sizeof(std::atomic<Block *>))];
+        std::atomic<Block *> next;
+      };
+
+      Block() noexcept {}
+      // starts the lifetime of the link over storage that is no longer handed out.
+      static Block *link(void *p, Block *next) noexcept {
+        Block *block = static_cast<Block *>(p);
+        std::construct_at(&block->next, next);
+        return block;
+      }
+    };
+    static_assert(std::is_trivially_destructible_v<std::atomic<Block *>>);
+    struct State {
+      AtomicIntrusiveStack<Block> free_blocks;
+      std::atomic<bool> alive;
+      size_t slab_size;
+      std::mutex slab_mutex;
+      std::vector<std::unique_ptr<Block[]>> slabs;
+
+      State(size_t slab_size) : free_blocks{}, alive{true}, slab_size{slab_size} {}
+
+      Block *new_slab() {
+        auto slab = std::make_unique_for_overwrite<Block[]>(slab_size);
+        Block *first = slab.get();
+        std::lock_guard lck{slab_mutex};
+        slabs.emplace_back(std::move(slab));
+        return first;
+      }
+    };
+
+  public:
+    static constexpr size_t magazine_size = 32;
+
+  private:
+    struct Magazine {
+      std::shared_ptr<State> state;
+      size_t count;
+      std::array<Block *, magazine_size> blocks;
+
+      Magazine(std::shared_ptr<State> s) : state{std::move(s)}, count{0}, blocks{} {}
+      Magazine(Magazine &&o) noexcept :
+        state{std::move(o.state)}, count{std::exchange(o.count, 0)}, blocks{o.blocks} {}
+      Magazine &operator=(Magazine &&o) noexcept {
+        flush();
+        state = std::move(o.state);
+        count = std::exchange(o.count, 0);
+        blocks = o.blocks;
+        return *this;
+      }
+
+      void drain(size_t n) noexcept {
+        if (n == 0) {
+          return;
+        }
+        Block *first = blocks[count - n];
+        for (size_t i = count - n; i < count; i += 1) {
+          Block::link(blocks[i], i + 1 < count ? blocks[i + 1] : nullptr);
+        }
+        state->free_blocks.push_chain(first, blocks[count - 1]);
+        count -= n;
+      }
+      void flush() noexcept {
+        if (state) {
+          drain(count);
+        }
+      }
+      ~Magazine() {
+        flush();
+      }
+    };
+
+    std::shared_ptr<State> __state;
+
+    static std::vector<Magazine> &__thread_magazines() {
+      static thread_local std::vector<Magazine> magazines;
+      return magazines;
+    }
+    Magazine &__magazine() {
+      auto &magazines = __thread_magazines();
+      for (auto &magazine : magazines) {
+        if (magazine.state == __state) {
+          return magazine;
+        }
+      }
+      // Magazines of destroyed pools are dropped whenever a thread meets a new pool.
+      std::erase_if(magazines, [](const Magazine &m) {
+        return !m.state->alive.load(std::memory_order_relaxed);
+      });
+      return magazines.emplace_back(__state);
+    }
+    void __refill(Magazine &magazine) {
+      while (magazine.count < magazine_size / 2) {
+        Block *block = __state->free_blocks.pop();
+        if (block == nullptr) {
+          break;
+        }
+        magazine.blocks[magazine.count++] = block;
+      }
+      if (magazine.count != 0) {
+        return;
+      }
+      Block *slab = __state->new_slab();
+      size_t cached = std::min(__state->slab_size, magazine_size / 2);
+      for (size_t i = 0; i < cached; i += 1) {
+        magazine.blocks[magazine.count++] = slab + i;
+      }
+      if (cached < __state->slab_size) {
+        for (size_t i = cached; i < __state->slab_size; i += 1) {
+          Block::link(slab + i, i + 1 < __state->slab_size ? slab + i + 1 : nullptr);
+        }
+        __state->free_blocks.push_chain(slab + cached, slab + __state->slab_size - 1);
+      }
+    }
+
+  public:
+    static constexpr size_t block_size = Size;
+    static constexpr size_t block_align = Align;
+
+    explicit BlockPool(size_t slab_size = 256) :
+      __state{std::make_shared<State>(std::max<size_t>(slab_size, 1))} {}
+    BlockPool(const BlockPool &) = delete;
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    void *allocate() {
+      Magazine &magazine = __magazine();
+      if (magazine.count == 0) {
+        __refill(magazine);
+      }
+      magazine.count -= 1;
+      return magazine.blocks[magazine.count]->storage;
+    }
+    /*
+      p has to come from allocate of this pool, it can be released by any thread. The first
+      release on a thread that never allocated from the pool registers a magazine for that thread,
+      when that allocation fails the block goes straight to the global free list instead.
+    */
+    void deallocate(void *p) noexcept {
+      Block *block = static_cast<Block *>(p);
+      Magazine *magazine = nullptr;
+      try {
+        magazine = &__magazine();
+      } catch (...) {
+        __state->free_blocks.push(Block::link(block, nullptr));
+        return;
+      }
+      if (magazine->count == magazine_size) {
+        magazine->drain(magazine_size / 2);
+      }
+      magazine->blocks[magazine->count++] = block;
+    }
+
+    ~BlockPool() {
+      __state->alive.store(false, std::memory_order_relaxed);
+      auto &magazines = __thread_magazines();
+      std::erase_if(magazines, [&](const Magazine &m) { return m.state == __state; });
+    }
+  };
+
+  /*
+    ObjectPool
+    creates and destroys objects of a single type on top of a BlockPool.
+  */
+  export template <class ValueType> class ObjectPool {
+    BlockPool<sizeof(ValueType), alignof(ValueType)> __pool;
+
+  public:
+    explicit ObjectPool(size_t slab_size = 256) : __pool{slab_size} {}
+
+    template <class... Args> requires(std::constructible_from<ValueType, Args...>)
+    ValueType *create(Args &&...args) {
+      void *p = __pool.allocate();
+      try {
+        return std::construct_at(static_cast<ValueType *>(p), std::forward<Args>(args)...);
+      } catch (...) {
+        __pool.deallocate(p);
+        throw;
+      }
+    }
+    void destroy(ValueType *v) noexcept {
+      std::destroy_at(v);
+      __pool.deallocate(v);
+    }
+
+    void *allocate() {
+      return __pool.allocate();
+    }
+    void deallocate(void *p) noexcept {
+      __pool.deallocate(p);
+    }
+  };
+
+  /*
+    BlockPoolResource
+    std::pmr::memory_resource serving every request of at most Size bytes and Align alignment from
+    a BlockPool, larger requests are forwarded to the upstream resource. Meant for node based pmr
+    containers whose nodes all have the same size.
+  */
+  export template <size_t Size, size_t Align = alignof(std::max_align_t)>
+  class BlockPoolResource : public std::pmr::memory_resource {
+    BlockPool<Size, Align> __pool;
+    std::pmr::memory_resource *__upstream;
+
+    static constexpr bool __fits(size_t bytes, size_t align) noexcept {
+      return bytes <= Size && align <= Align;
+    }
+
+  public:
+    explicit BlockPoolResource(
+      size_t slab_size = 256, std::pmr::memory_resource *upstream = std::pmr::get_default_resource()
+    ) : __pool{slab_size}, __upstream{upstream} {}
+
+    std::pmr::memory_resource *upstream_resource() const noexcept {
+      return __upstream;
+    }
+
+  protected:
+    void *do_allocate(size_t bytes, size_t align) override {
+      if (__fits(bytes, align)) {
+        return __pool.allocate();
+      }
+      return __upstream->allocate(bytes, align);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t align) override {
+      if (__fits(bytes, align)) {
+        __pool.deallocate(p);
+      } else {
+        __upstream->deallocate(p, bytes, align);
+      }
+    }
+    bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+      return this == &o;
+    }
+  };
+
+  /*
+    SeqLock
+    a trivially copyable value behind a sequence counter for read mostly data. Writers serialise on
+    the counter and keep it odd while the value is being written, readers copy the value and retry
+    when the counter was odd or changed in the meantime. Readers never write shared memory, so any
+    number of them can read without bouncing a cache line between cores. The value is kept in
+    relaxed atomic words, a torn copy is discarded but never a data race.
+  */
+  export template <class ValueType> requires(std::is_trivially_copyable_v<ValueType>)
+  class SeqLock {
+    static constexpr size_t __word_count = (sizeof(ValueType) + 7) / 8;
+
+    alignas(cache_line_size) std::atomic<uint64_t> __sequence;
+    std::array<std::atomic<uint64_t>, __word_count> __words;
+
+    void __write_words(const ValueType &value) noexcept {
+      std::array<uint64_t, __word_count> words{};
+      std::memcpy(
+        static_cast<void *>(words.data()), static_cast<const void *>(&value), sizeof(ValueType)
+      );
+      for (size_t i = 0; i < __word_count; i += 1) {
+        __words[i].store(words[i], std::memory_order_relaxed);
+      }
+    }
+    ValueType __read_words() const noexcept {
+      std::array<uint64_t, __word_count> words;
+      for (size_t i = 0; i < __word_count; i += 1) {
+        words[i] = __words[i].load(std::memory_order_relaxed);
+      }
+      std::array<std::byte, sizeof(ValueType)> bytes;
+      std::memcpy(
+        static_cast<void *>(bytes.data()),
+        static_cast<const void *>(words.data()),
+        sizeof(ValueType)
+      );
+      return std::bit_cast<ValueType>(bytes);
+    }
+
+    uint64_t __lock() noexcept {
+      uint64_t sequence = __sequence.load(std::memory_order_relaxed);
+      while (true) {
+        if (sequence % 2 == 1) {
+          std::this_thread::yield();
+          sequence = __sequence.load(std::memory_order_relaxed);
+        } else if (__sequence.compare_exchange_weak(
+                     sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed
+                   )) {
+          // keeps the value stores from becoming visible before the odd sequence.
+          std::atomic_thread_fence(std::memory_order_release);
+          return sequence;
+        }
+      }
+    }
+    void __unlock(uint64_t sequence) noexcept {
+      __sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+  public:
+    SeqLock() noexcept(std::is_nothrow_default_constructible_v<ValueType>) : SeqLock{ValueType{}} {}
+    explicit SeqLock(const ValueType &value) noexcept : __sequence{0} {
+      __write_words(value);
+    }
+    SeqLock(const SeqLock &) = delete;
+    SeqLock &operator=(const SeqLock &) = delete;
+
+    /*
+      Single read attempt, nullopt when a writer was active.
+    */
+    std::optional<ValueType> try_load() const noexcept {
+      uint64_t before = __sequence.load(std::memory_order_acquire);
+      if (before % 2 == 1) {
+        return std::nullopt;
+      }
+      ValueType value = __read_words();
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (__sequence.load(std::memory_order_relaxed) != before) {
+        return std::nullopt;
+      }
+      return value;
+    }
+    ValueType load() const noexcept {
+      while (true) {
+        if (auto value = try_load(); value) {
+          return *value;
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    void store(const ValueType &value) noexcept {
+      uint64_t sequence = __lock();
+      __write_words(value);
+      __unlock(sequence);
+    }
+    /*
+      Read modify write under the writer lock, f receives a mutable copy of the current value.
+    */
+    template <std::invocable<ValueType &> F> void update(F &&f) {
+      uint64_t sequence = __lock();
+      ValueType value = __read_words();
+      try {
+        std::invoke(std::forward<F>(f), value);
+      } catch (...) {
+        __unlock(sequence);
+        throw;
+      }
+      __write_words(value);
+      __unlock(sequence);
+    }
+
+    // number of completed writes.
+    uint64_t version() const noexcept {
+      return __sequence.load(std::memory_order_acquire) / 2;
+    }
+  };
+
+  /*
+    VersionedSnapshot
+    RCU style holder of an immutable ValueType for data that is read far more often than it is
+    replaced. A writer publishes a new heap allocated value into a HeadType pointer whose tag is the
+    version, readers load pointer and version together and hold on to the value through a
+    ReadGuard.
+    Replaced values are reclaimed by epochs: a reader announces the global epoch in a reader slot of
+    its own (one cache line per thread, reused after the thread exits) for as long as it holds a
+    guard, and a value retired at epoch e is only deleted once no announced epoch is e or lower.
+    Readers never lock and only write their own slot, writers are serialised by a mutex.
+  */
+  export template <class ValueType, class HeadType = DefaultTaggedPtr>
+  requires(alignof(ValueType) >= HeadType::required_alignment)
+  class VersionedSnapshot {
+    using TagType = typename HeadType::TagType;
+
+    struct alignas(cache_line_size) ReaderSlot {
+      // 0 while the owning thread does not hold a guard.
+      std::atomic<uint64_t> epoch;
+      std::atomic<bool> in_use;
+      ReaderSlot *next;
+    };
+    struct Retired {
+      ValueType *value;
+      uint64_t epoch;
+    };
+    struct State {
+      std::atomic<HeadType> current;
+      std::atomic<uint64_t> epoch;
+      std::atomic<ReaderSlot *> slots;
+      std::atomic<bool> alive;
+      std::mutex writer_mutex;
+      std::vector<Retired> retired;
+
+      State(ValueType *value) :
+        current{HeadType::from_pair(value, TagType{})}, epoch{1}, slots{nullptr}, alive{true} {}
+
+      ReaderSlot *claim_slot() {
+        for (ReaderSlot *slot = slots.load(std::memory_order_acquire); slot != nullptr;
+             slot = slot->next) {
+          bool in_use = false;
+          if (!slot->in_use.load(std::memory_order_relaxed) &&
+              slot->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+            return slot;
+          }
+        }
+        // Slots are only ever prepended and live as long as the state.
+        ReaderSlot *slot = new ReaderSlot{{0}, {true}, slots.load(std::memory_order_relaxed)};
+        while (!slots.compare_exchange_weak(
+          slot->next, slot, std::memory_order_release, std::memory_order_relaxed
+        )) {
+        }
+        return slot;
+      }
+
+      // oldest epoch announced by a reader, uint64_t max when every reader is quiescent.
+      uint64_t oldest_reader_epoch() const noexcept {
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        for (ReaderSlot *slot = slots.load(std::memory_order_acquire); slot != nullptr;
+             slot = slot->next) {
+          uint64_t epoch = slot->epoch.load();
+          if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+          }
+        }
+        return oldest;
+      }
+
+      ~State() {
+        delete static_cast<ValueType *>(current.load(std::memory_order_relaxed).raw_ptr());
+        for (const auto &r : retired) {
+          delete r.value;
+        }
+        ReaderSlot *slot = slots.load(std::memory_order_relaxed);
+        while (slot != nullptr) {
+          delete std::exchange(slot, slot->next);
+        }
+      }
+    };
+
+    struct ReaderHandle {
+      std::shared_ptr<State> state;
+      ReaderSlot *slot;
+
+      ReaderHandle(std::shared_ptr<State> s) : state{std::move(s)}, slot{state->claim_slot()} {}
+      ReaderHandle(ReaderHandle &&o) noexcept :
+        state{std::move(o.state)}, slot{std::exchange(o.slot, nullptr)} {}
+      ReaderHandle &operator=(ReaderHandle &&o) noexcept {
+        release();
+        state = std::move(o.state);
+        slot = std::exchange(o.slot, nullptr);
+        return *this;
+      }
+
+      void release() noexcept {
+        if (slot != nullptr) {
+          slot->epoch.store(0, std::memory_order_release);
+          slot->in_use.store(false, std::memory_order_release);
+        }
+      }
+      ~ReaderHandle() {
+        release();
+      }
+    };
+
+    std::shared_ptr<State> __state;
+
+    static std::vector<ReaderHandle> &__thread_handles() {
+      static thread_local std::vector<ReaderHandle> handles;
+      return handles;
+    }
+    ReaderSlot *__reader_slot() const {
+      auto &handles = __thread_handles();
+      for (auto &handle : handles) {
+        if (handle.state == __state) {
+          return handle.slot;
+        }
+      }
+      std::erase_if(handles, [](const ReaderHandle &h) {
+        return !h.state->alive.load(std::memory_order_relaxed);
+      });
+      return handles.emplace_back(__state).slot;
+    }
+
+    void __reclaim() noexcept {
+      uint64_t oldest = __state->oldest_reader_epoch();
+      std::erase_if(__state->retired, [&](const Retired &r) {
+        if (r.epoch >= oldest) {
+          return false;
+        }
+        delete r.value;
+        return true;
+      });
+    }
+    // requires the writer mutex.
+    void __publish(ValueType *value) {
+      __state->retired.reserve(__state->retired.size() + 1);
+      HeadType previous = __state->current.load(std::memory_order_relaxed);
+      __state->current.store(
+        HeadType::from_pair(value, static_cast<TagType>(previous.tag() + 1))
+      );
+      uint64_t epoch = __state->epoch.fetch_add(1);
+      __state->retired.push_back(Retired{static_cast<ValueType *>(previous.raw_ptr()), epoch});
+      __reclaim();
+    }
+
+  public:
+    /*
+      Pins the value that was current when it was created, the value stays alive and unchanged
+      until the guard is destroyed. Guards may nest within a thread.
+    */
+    class ReadGuard {
+      ReaderSlot *__slot;
+      bool __owns_slot;
+      HeadType __head;
+
+      ReadGuard(ReaderSlot *slot, const State &state) noexcept :
+        __slot{slot}, __owns_slot{slot->epoch.load(std::memory_order_relaxed) == 0},
+        __head{HeadType::null()} {
+        if (__owns_slot) {
+          __slot->epoch.store(state.epoch.load());
+        }
+        __head = state.current.load();
+      }
+      friend class VersionedSnapshot;
+
+    public:
+      ReadGuard(const ReadGuard &) = delete;
+      ReadGuard &operator=(const ReadGuard &) = delete;
+
+      const ValueType &operator*() const noexcept {
+        return *get();
+      }
+      const ValueType *operator->() const noexcept {
+        return get();
+      }
+      const ValueType *get() const noexcept {
+        return static_cast<const ValueType *>(__head.raw_ptr());
+      }
+      TagType version() const noexcept {
+        return __head.tag();
+      }
+
+      ~ReadGuard() {
+        if (__owns_slot) {
+          __slot->epoch.store(0, std::memory_order_release);
+        }
+      }
+    };
+
+    template <class... Args> requires(std::constructible_from<ValueType, Args...>)
+    explicit VersionedSnapshot(Args &&...args) :
+      __state{std::make_shared<State>(new ValueType(std::forward<Args>(args)...))} {}
+    VersionedSnapshot(const VersionedSnapshot &) = delete;
+    VersionedSnapshot &operator=(const VersionedSnapshot &) = delete;
+
+    ReadGuard read() const {
+      return ReadGuard{__reader_slot(), *__state};
+    }
+    // wraps around with the tag of HeadType.
+    TagType version() const noexcept {
+      return __state->current.load().tag();
+    }
+
+    template <class... Args> requires(std::constructible_from<ValueType, Args...>)
+    void emplace(Args &&...args) {
+      auto value = std::make_unique<ValueType>(std::forward<Args>(args)...);
+      std::lock_guard lck{__state->writer_mutex};
+      __publish(value.release());
+    }
+    void store(ValueType value) {
+      emplace(std::move(value));
+    }
+    /*
+      Publishes f(current) where f receives the current value, writers are serialised so no
+      update is lost.
+    */
+    template <std::invocable<const ValueType &> F>
+    requires(std::convertible_to<std::invoke_result_t<F, const ValueType &>, ValueType>)
+    void update(F &&f) {
+      std::lock_guard lck{__state->writer_mutex};
+      const auto *current =
+        static_cast<const ValueType *>(__state->current.load(std::memory_order_relaxed).raw_ptr());
+      auto value = std::make_unique<ValueType>(std::invoke(std::forward<F>(f), *current));
+      __publish(value.release());
+    }
+    /*
+      Deletes every replaced value no reader can still see, values are otherwise reclaimed on the
+      next publish.
+    */
+    void reclaim() {
+      std::lock_guard lck{__state->writer_mutex};
+      __reclaim();
+    }
+    size_t retired_count() const {
+      std::lock_guard lck{__state->writer_mutex};
+      return __state->retired.size();
+    }
+
+    ~VersionedSnapshot() {
+      __state->alive.store(false, std::memory_order_relaxed);
+      auto &handles = __thread_handles();
+      std::erase_if(handles, [&](const ReaderHandle &h) { return h.state == __state; });
+    }
+  };
+}
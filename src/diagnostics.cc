@@ -0,0 +1,234 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+export module jowi.generic:diagnostics;
+import :atomic;
+import :is_formattable_error;
+
+namespace jowi::generic {
+  /*
+    DiagnosticsSink
+    high throughput sink for errors and traces. Every recording thread owns a SpscRingQueue of
+    EntryType, record only locks the first time a thread records into the sink, to register its
+    ring, and never formats: with the default LazyErrorFormatter the error is copied into its slot
+    and only formatted by flush, with FixedErrorFormatter it is formatted into a fixed size slot by
+    the recording thread. flush formats the recorded entries ring by ring and hands every one of
+    them to Writer, run_in_background flushes from a background thread. An entry recorded into a
+    full ring is dropped and counted, see dropped.
+    The rings belong to the sink: the ring of an exited thread is freed by the first flush that
+    finds it drained, every ring is freed with the sink. A thread only keeps a small handle per
+    sink it recorded into, handles of destroyed sinks are dropped when the thread records into a
+    new sink or exits. The sink has to outlive every call to record.
+    Exceptions thrown by Writer or by formatting on the background thread, or in the destructor,
+    are swallowed and counted, see failed_flushes. The entry being written is lost, the others are
+    written by the next flush.
+  */
+  export template <class Writer, class EntryType = LazyErrorFormatter<>>
+  requires(std::invocable<Writer &, std::string_view>)
+  class DiagnosticsSink {
+    struct Ring {
+      SpscRingQueue<EntryType> queue;
+      // set when the recording thread exits, nothing is pushed into the ring afterwards.
+      std::atomic<bool> orphaned;
+
+      Ring(size_t capacity) : queue{capacity}, orphaned{false} {}
+    };
+    struct State {
+      size_t ring_capacity;
+      std::atomic<uint64_t> dropped;
+      std::atomic<uint64_t> failed_flushes;
+      std::mutex rings_mut;
+      std::vector<std::unique_ptr<Ring>> rings;
+
+      State(size_t ring_capacity) : ring_capacity{ring_capacity}, dropped{0}, failed_flushes{0} {}
+    };
+    /*
+      per thread handle on the ring of one sink. The ring is owned by the state, key identifies the
+      sink without touching the reference count of state.
+    */
+    struct Producer {
+      std::weak_ptr<State> state;
+      const State *key;
+      Ring *ring;
+
+      Producer(const std::shared_ptr<State> &s, Ring *r) noexcept :
+        state{s}, key{s.get()}, ring{r} {}
+      Producer(Producer &&o) noexcept :
+        state{std::move(o.state)}, key{o.key}, ring{std::exchange(o.ring, nullptr)} {}
+      Producer &operator=(Producer &&o) noexcept {
+        std::swap(state, o.state);
+        std::swap(key, o.key);
+        std::swap(ring, o.ring);
+        return *this;
+      }
+      ~Producer() {
+        if (ring == nullptr) {
+          return;
+        }
+        // keeps the rings alive while the ring is marked.
+        if (auto s = state.lock()) {
+          ring->orphaned.store(true, std::memory_order_release);
+        }
+      }
+    };
+
+    std::shared_ptr<State> __state;
+    Writer __writer;
+    // guards __line and the consumer side of the rings.
+    std::mutex __flush_mut;
+    std::string __line;
+    std::mutex __worker_mut;
+    std::condition_variable_any __worker_cv;
+    std::jthread __worker;
+
+    static std::vector<Producer> &__thread_producers() {
+      static thread_local std::vector<Producer> producers;
+      return producers;
+    }
+    SpscRingQueue<EntryType> &__ring() {
+      auto &producers = __thread_producers();
+      for (auto &producer : producers) {
+        // a destroyed sink may have left a handle with the same key behind.
+        if (producer.key == __state.get() && !producer.state.expired()) {
+          return producer.ring->queue;
+        }
+      }
+      // handles of destroyed sinks are dropped whenever a thread meets a new sink.
+      std::erase_if(producers, [](const Producer &p) { return p.state.expired(); });
+      auto ring = std::make_unique<Ring>(__state->ring_capacity);
+      Ring *r = ring.get();
+      producers.reserve(producers.size() + 1);
+      {
+        std::lock_guard l{__state->rings_mut};
+        __state->rings.emplace_back(std::move(ring));
+      }
+      return producers.emplace_back(__state, r).ring->queue;
+    }
+    size_t __unflushed() {
+      std::lock_guard l{__state->rings_mut};
+      size_t count = 0;
+      for (auto &ring : __state->rings) {
+        count += ring->queue.size();
+      }
+      return count;
+    }
+    // flushes until nothing is left, or until a throwing flush stops making progress.
+    void __flush_all() noexcept {
+      while (true) {
+        size_t before = __unflushed();
+        try {
+          flush();
+          return;
+        } catch (...) {
+          __state->failed_flushes.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (__unflushed() >= before) {
+          return;
+        }
+      }
+    }
+
+  public:
+    explicit DiagnosticsSink(Writer writer = Writer{}, size_t ring_capacity = 1024) :
+      __state{std::make_shared<State>(ring_capacity)}, __writer{std::move(writer)} {}
+    DiagnosticsSink(const DiagnosticsSink &) = delete;
+    DiagnosticsSink &operator=(const DiagnosticsSink &) = delete;
+
+    /*
+      records e into the ring of the calling thread, false when the ring is full.
+    */
+    template <IsFormattableError E> requires(std::constructible_from<EntryType, const E &>)
+    bool record(const E &e) {
+      auto &ring = __ring();
+      // checked before try_emplace constructs the entry, recording into a full ring stays cheap.
+      if (ring.size() >= ring.capacity() || !ring.try_emplace(e)) {
+        __state->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      return true;
+    }
+
+    /*
+      formats and writes every entry recorded so far, returns how many were written.
+    */
+    size_t flush() {
+      std::lock_guard flush_lock{__flush_mut};
+      std::vector<Ring *> rings;
+      {
+        std::lock_guard l{__state->rings_mut};
+        rings.reserve(__state->rings.size());
+        for (auto &ring : __state->rings) {
+          rings.emplace_back(ring.get());
+        }
+      }
+      size_t count = 0;
+      for (Ring *ring : rings) {
+        while (auto entry = ring->queue.try_pop()) {
+          __line.clear();
+          std::format_to(std::back_inserter(__line), "{}", *entry);
+          std::invoke(__writer, std::string_view{__line});
+          count += 1;
+        }
+      }
+      std::lock_guard l{__state->rings_mut};
+      // an orphaned ring gets no new entries, once drained it is not needed anymore.
+      std::erase_if(__state->rings, [](const auto &ring) {
+        return ring->orphaned.load(std::memory_order_acquire) && ring->queue.empty();
+      });
+      return count;
+    }
+    uint64_t dropped() const noexcept {
+      return __state->dropped.load(std::memory_order_relaxed);
+    }
+    // flushes of the background thread or of the destructor that threw.
+    uint64_t failed_flushes() const noexcept {
+      return __state->failed_flushes.load(std::memory_order_relaxed);
+    }
+
+    /*
+      flushes every interval on a background thread until the sink is destroyed.
+    */
+    void run_in_background(std::chrono::milliseconds interval) {
+      if (__worker.joinable()) {
+        return;
+      }
+      __worker = std::jthread{[this, interval](std::stop_token stop) {
+        while (!stop.stop_requested()) {
+          {
+            std::unique_lock l{__worker_mut};
+            __worker_cv.wait_for(l, stop, interval, []() { return false; });
+          }
+          try {
+            flush();
+          } catch (...) {
+            __state->failed_flushes.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      }};
+    }
+
+    ~DiagnosticsSink() {
+      if (__worker.joinable()) {
+        __worker.request_stop();
+        __worker.join();
+      }
+      __flush_all();
+    }
+  };
+}
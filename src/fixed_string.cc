@@ -1,11 +1,122 @@
 module;
 #include <algorithm>
 #include <array>
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <compare>
+#include <cstdint>
+#include <cstring>
 #include <format>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string_view>
+#if defined(__SSE2__)
+  #include <immintrin.h>
+#endif
 export module jowi.generic:fixed_string;
 
 namespace jowi::generic {
+  /*
+    Byte kernels over FixedString buffers. Readable is the number of bytes that may be loaded from
+    every pointer, the buffer size is known at compile time, so whole blocks are loaded even past
+    the string length and the result is clamped to len afterwards.
+  */
+  // The n <= 8 bytes at p as a little endian word, missing bytes are zero.
+  constexpr uint64_t load_le_word(const char *p, size_t n) noexcept {
+    uint64_t word = 0;
+    if (std::is_constant_evaluated()) {
+      for (size_t i = 0; i < n; i += 1) {
+        word |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (i * 8);
+      }
+      return word;
+    }
+    std::memcpy(static_cast<void *>(&word), static_cast<const void *>(p), n);
+    if constexpr (std::endian::native == std::endian::big) {
+      word = std::byteswap(word);
+    }
+    return word;
+  }
+
+  // index of the first byte in [0, len) that differs between l and r, len when there is none.
+  template <size_t Readable>
+  constexpr size_t string_mismatch(const char *l, const char *r, size_t len) noexcept {
+    size_t i = 0;
+    if (!std::is_constant_evaluated()) {
+#if defined(__SSE2__)
+      for (; i < len && i + 16 <= Readable; i += 16) {
+        __m128i lb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(l + i));
+        __m128i rb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r + i));
+        uint32_t diff = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lb, rb))) & 0xFFFF;
+        if (diff != 0) {
+          return std::min(i + std::countr_zero(diff), len);
+        }
+      }
+#endif
+      for (; i < len && i + 8 <= Readable; i += 8) {
+        uint64_t diff = load_le_word(l + i, 8) ^ load_le_word(r + i, 8);
+        if (diff != 0) {
+          return std::min(i + std::countr_zero(diff) / 8, len);
+        }
+      }
+    }
+    for (; i < len; i += 1) {
+      if (l[i] != r[i]) {
+        return i;
+      }
+    }
+    return len;
+  }
+
+  // index of the first c in [pos, len), len when there is none.
+  template <size_t Readable>
+  constexpr size_t string_find_char(const char *s, size_t len, size_t pos, char c) noexcept {
+    size_t i = pos;
+#if defined(__SSE2__)
+    if (!std::is_constant_evaluated()) {
+      __m128i needle = _mm_set1_epi8(c);
+      for (; i < len && i + 16 <= Readable; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+        uint32_t match = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        if (match != 0) {
+          return std::min(i + std::countr_zero(match), len);
+        }
+      }
+    }
+#endif
+    for (; i < len; i += 1) {
+      if (s[i] == c) {
+        return i;
+      }
+    }
+    return len;
+  }
+
+  // hashes 8 bytes at a time, the bytes past len in the last word are masked off.
+  template <size_t Readable>
+  constexpr uint64_t string_word_hash(const char *s, size_t len) noexcept {
+    constexpr uint64_t multiplier = 0x9E37'79B9'7F4A'7C15;
+    uint64_t h = multiplier ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+      h = (h ^ load_le_word(s + i, 8)) * multiplier;
+      h ^= h >> 29;
+    }
+    if (i < len) {
+      size_t rest = len - i;
+      uint64_t word = i + 8 <= Readable
+        ? load_le_word(s + i, 8) & (~uint64_t{0} >> (64 - rest * 8))
+        : load_le_word(s + i, rest);
+      h = (h ^ word) * multiplier;
+    }
+    // splitmix64 finalizer.
+    h = (h ^ (h >> 30)) * 0xBF58'476D'1CE4'E5B9;
+    h = (h ^ (h >> 27)) * 0x94D0'49BB'1331'11EB;
+    return h ^ (h >> 31);
+  }
+
   /*
     FixedString
     a static buffer that guarantees that the last character is a null character. Most of the time
@@ -13,16 +124,40 @@ namespace jowi::generic {
   */
   export template <size_t N> requires(N > 1)
   struct FixedString {
-  private:
+    /*
+      The members are public only so that FixedString is a structural type and can be used as a
+      template argument (see interned), they are not part of the interface.
+    */
     // The last character is reserved for the null string and should never be touched.
     std::array<char, N + 1> __buf;
     // This is the current theoretical length of the string.
     size_t __len;
+    // Set when a write had to drop characters, cleared by truncate.
+    bool __truncated;
+
+  private:
+
+    // Appends the converted characters, when they do not fit the conversion is redone into a
+    // scratch buffer so that the prefix that fits is kept.
+    template <size_t ScratchSize, class Convert> constexpr void __append_chars(Convert &&convert) {
+      auto [ptr, ec] = convert(end(), __buf.data() + N);
+      if (ec == std::errc{}) {
+        __len = static_cast<size_t>(ptr - __buf.data());
+        return;
+      }
+      std::array<char, ScratchSize> scratch;
+      auto [scratch_ptr, scratch_ec] = convert(scratch.data(), scratch.data() + ScratchSize);
+      if (scratch_ec == std::errc{}) {
+        append(std::string_view{scratch.data(), scratch_ptr});
+      } else {
+        __truncated = true;
+      }
+    }
 
   public:
     using ValueType = char;
     using value_type = char;
-    constexpr FixedString() noexcept : __buf{0}, __len{0} {}
+    constexpr FixedString() noexcept : __buf{0}, __len{0}, __truncated{false} {}
     template <size_t N2> requires(N2 < N)
     constexpr FixedString(const char (&s)[N2]) noexcept : FixedString() {
       std::ranges::copy_n(s, N2 - 1, __buf.begin());
@@ -34,6 +169,7 @@ namespace jowi::generic {
     }
     constexpr FixedString(std::string_view c) noexcept : FixedString() {
       __len = std::min(c.length(), N);
+      __truncated = c.length() > N;
       std::ranges::copy_n(c.begin(), __len, __buf.begin());
     }
     constexpr operator std::string_view() const noexcept {
@@ -74,6 +210,10 @@ namespace jowi::generic {
     constexpr size_t empty_space() const noexcept {
       return N - __len;
     }
+    // true when a write since construction or the last truncate dropped characters.
+    constexpr bool truncated() const noexcept {
+      return __truncated;
+    }
     constexpr const char *c_str() const noexcept {
       return __buf.begin();
     }
@@ -82,21 +222,65 @@ namespace jowi::generic {
     constexpr void truncate() noexcept {
       std::ranges::fill_n(begin(), __len, 0);
       __len = 0;
+      __truncated = false;
     }
     constexpr char &emplace_back(char c) noexcept {
       if (__len < N) {
         __buf[__len] = c;
         __len += 1;
+      } else {
+        __truncated = true;
       }
       return __buf[__len - 1];
     }
     constexpr char &push_back(char c) noexcept {
       return emplace_back(c);
     }
+    /*
+      Formats straight into the free space after the current content, output that does not fit is
+      dropped and marks the string as truncated.
+    */
     template <class... Args> requires(std::formattable<Args, char> && ...)
     constexpr void emplace_format(std::format_string<Args...> fmt, Args &&...args) {
-      auto inserter = std::back_inserter(*this);
-      std::format_to_n(inserter, empty_space(), fmt, std::forward<Args>(args)...);
+      size_t space = empty_space();
+      auto result = std::format_to_n(
+        end(), static_cast<std::ptrdiff_t>(space), fmt, std::forward<Args>(args)...
+      );
+      size_t written = static_cast<size_t>(result.size);
+      __len += std::min(written, space);
+      __truncated = __truncated || written > space;
+    }
+    constexpr FixedString &append(std::string_view s) noexcept {
+      size_t count = std::min(s.length(), empty_space());
+      std::ranges::copy_n(s.begin(), count, end());
+      __len += count;
+      __truncated = __truncated || count < s.length();
+      return *this;
+    }
+    template <std::integral IntType> requires(!std::same_as<IntType, bool>)
+    constexpr FixedString &append_int(IntType value, int base = 10) noexcept {
+      __append_chars<sizeof(IntType) * 8 + 1>([&](char *first, char *last) {
+        return std::to_chars(first, last, value, base);
+      });
+      return *this;
+    }
+    /*
+      Shortest round trip representation, or the given format and precision. A number that does
+      not fit in 128 characters is dropped entirely.
+    */
+    template <std::floating_point FloatType>
+    FixedString &append_float(FloatType value) noexcept {
+      __append_chars<128>([&](char *first, char *last) {
+        return std::to_chars(first, last, value);
+      });
+      return *this;
+    }
+    template <std::floating_point FloatType>
+    FixedString &append_float(FloatType value, std::chars_format fmt, int precision) noexcept {
+      __append_chars<128>([&](char *first, char *last) {
+        return std::to_chars(first, last, value, fmt, precision);
+      });
+      return *this;
     }
 
     constexpr std::optional<std::reference_wrapper<char>> operator[](size_t id) noexcept {
@@ -107,31 +291,469 @@ namespace jowi::generic {
     }
 
     constexpr void unsafe_set_length(size_t l) noexcept {
-      if (__len <= N) {
+      if (l <= N) {
         __len = l;
       }
     }
 
-    // Comparison Operator
-    friend constexpr bool operator==(const FixedString<N> &l, std::string_view r) {
-      if (l.length() != r.length()) {
-        return false;
+    // Search Functions
+    constexpr std::optional<size_t> find(char c, size_t pos = 0) const noexcept {
+      size_t at = string_find_char<N + 1>(__buf.data(), __len, pos, c);
+      if (at == __len) {
+        return std::nullopt;
+      }
+      return at;
+    }
+    constexpr std::optional<size_t> find(std::string_view s, size_t pos = 0) const noexcept {
+      if (s.length() > __len || pos > __len - s.length()) {
+        return std::nullopt;
       }
-      for (size_t i = 0; i < l.length(); i += 1) {
-        if (l[i].value() != r[i]) {
-          return false;
+      if (s.empty()) {
+        return pos;
+      }
+      // candidates are found by the first character, the rest is compared with memcmp.
+      size_t last = __len - s.length();
+      while (pos <= last) {
+        size_t at = string_find_char<N + 1>(__buf.data(), last + 1, pos, s.front());
+        if (at > last) {
+          return std::nullopt;
+        }
+        if (std::string_view{__buf.data() + at, s.length()} == s) {
+          return at;
         }
+        pos = at + 1;
       }
-      return true;
+      return std::nullopt;
+    }
+    constexpr bool contains(char c) const noexcept {
+      return find(c).has_value();
+    }
+    constexpr bool contains(std::string_view s) const noexcept {
+      return find(s).has_value();
+    }
+    constexpr bool starts_with(std::string_view s) const noexcept {
+      return std::string_view{*this}.starts_with(s);
+    }
+    constexpr bool ends_with(std::string_view s) const noexcept {
+      return std::string_view{*this}.ends_with(s);
+    }
+    constexpr uint64_t hash() const noexcept {
+      return string_word_hash<N + 1>(__buf.data(), __len);
+    }
+
+    // Comparison Operator
+    template <size_t N2>
+    friend constexpr bool operator==(const FixedString<N> &l, const FixedString<N2> &r) noexcept {
+      return l.length() == r.length() &&
+        string_mismatch<std::min(N, N2) + 1>(l.c_str(), r.c_str(), l.length()) == l.length();
+    }
+    template <size_t N2>
+    friend constexpr std::strong_ordering operator<=>(
+      const FixedString<N> &l, const FixedString<N2> &r
+    ) noexcept {
+      size_t common = std::min(l.length(), r.length());
+      size_t at = string_mismatch<std::min(N, N2) + 1>(l.c_str(), r.c_str(), common);
+      if (at != common) {
+        // same ordering as std::string_view, characters compare as unsigned char.
+        return static_cast<unsigned char>(l.c_str()[at]) <=>
+          static_cast<unsigned char>(r.c_str()[at]);
+      }
+      return l.length() <=> r.length();
+    }
+    friend constexpr bool operator==(const FixedString<N> &l, std::string_view r) noexcept {
+      return std::string_view{l} == r;
+    }
+    friend constexpr std::strong_ordering operator<=>(
+      const FixedString<N> &l, std::string_view r
+    ) noexcept {
+      return std::string_view{l} <=> r;
     }
     template <size_t NR>
-    friend constexpr bool operator==(const FixedString<N> &l, const char (&r)[NR]) {
-      return l == std::string_view{r, r + NR};
+    friend constexpr bool operator==(const FixedString<N> &l, const char (&r)[NR]) noexcept {
+      return l == std::string_view{r};
+    }
+    friend constexpr bool operator==(const FixedString<N> &l, const char *r) noexcept {
+      return l == std::string_view{r};
+    }
+  };
+  // S reduced to its characters: the smallest capacity, no truncated flag, no stale bytes.
+  template <FixedString S> consteval auto interned_key() {
+    constexpr std::string_view text = S;
+    FixedString<std::max<size_t>(text.length() + 1, 2)> key{};
+    key.append(text);
+    return key;
+  }
+  template <FixedString Key> inline constexpr std::string_view interned_storage = Key;
+
+  /*
+    A string_view of a template parameter object holding the characters of S. S is normalised
+    first, its capacity, truncated flag and bytes past the end play no part, so every S with the
+    same characters shares the same address and can be compared by pointer.
+  */
+  export template <FixedString S>
+  inline constexpr std::string_view interned = interned_storage<interned_key<S>()>;
+
+  /*
+    SmallString
+    growable string with the FixedString interface. Up to N characters are stored inline, longer
+    strings spill to a buffer from Allocator, the string is always null terminated. Converting from
+    and to a FixedString of the same size is a copy of the characters only.
+  */
+  export template <size_t N, class Allocator = std::allocator<char>> requires(N > 1)
+  struct SmallString {
+  private:
+    using AllocTraits = std::allocator_traits<Allocator>;
+
+    // __data is __buf while the string is inline.
+    char *__data;
+    size_t __len;
+    size_t __cap;
+    std::array<char, N + 1> __buf;
+    [[no_unique_address]] Allocator __alloc;
+
+    constexpr bool __on_heap() const noexcept {
+      return __data != __buf.data();
+    }
+    constexpr void __release() noexcept {
+      if (__on_heap()) {
+        AllocTraits::deallocate(__alloc, __data, __cap + 1);
+      }
+    }
+    constexpr void __grow(size_t min_cap) {
+      size_t new_cap = std::max(min_cap, __cap * 2);
+      char *data = AllocTraits::allocate(__alloc, new_cap + 1);
+      std::ranges::copy_n(__data, __len + 1, data);
+      __release();
+      __data = data;
+      __cap = new_cap;
+    }
+    constexpr void __set_length(size_t l) noexcept {
+      __len = l;
+      __data[__len] = 0;
+    }
+
+  public:
+    using ValueType = char;
+    using value_type = char;
+    using allocator_type = Allocator;
+
+    constexpr SmallString(const Allocator &alloc = Allocator{}) noexcept :
+      __data{nullptr}, __len{0}, __cap{N}, __buf{0}, __alloc{alloc} {
+      __data = __buf.data();
+    }
+    template <size_t N2>
+    constexpr SmallString(const char (&s)[N2], const Allocator &alloc = Allocator{}) :
+      SmallString(std::string_view{s, N2 - 1}, alloc) {}
+    constexpr SmallString(std::string_view s, const Allocator &alloc = Allocator{}) :
+      SmallString(alloc) {
+      append(s);
+    }
+    template <size_t N2>
+    constexpr SmallString(const FixedString<N2> &s, const Allocator &alloc = Allocator{}) :
+      SmallString(std::string_view{s}, alloc) {}
+
+    constexpr SmallString(const SmallString &o) :
+      SmallString(o, AllocTraits::select_on_container_copy_construction(o.__alloc)) {}
+    constexpr SmallString(const SmallString &o, const Allocator &alloc) :
+      SmallString(std::string_view{o}, alloc) {}
+    constexpr SmallString(SmallString &&o) noexcept : SmallString(o.__alloc) {
+      if (o.__on_heap()) {
+        __data = std::exchange(o.__data, o.__buf.data());
+        __cap = std::exchange(o.__cap, N);
+        __len = std::exchange(o.__len, 0);
+        o.__buf[0] = 0;
+      } else {
+        std::ranges::copy_n(o.__buf.begin(), o.__len + 1, __buf.begin());
+        __len = std::exchange(o.__len, 0);
+        o.__buf[0] = 0;
+      }
+    }
+    // Assignment keeps the allocator of this string, as for pmr containers.
+    constexpr SmallString &operator=(const SmallString &o) {
+      if (this != &o) {
+        assign(o);
+      }
+      return *this;
+    }
+    constexpr SmallString &operator=(SmallString &&o) noexcept(
+      AllocTraits::is_always_equal::value
+    ) {
+      if (this == &o) {
+        return *this;
+      }
+      if (o.__on_heap() && __alloc == o.__alloc) {
+        __release();
+        __data = std::exchange(o.__data, o.__buf.data());
+        __cap = std::exchange(o.__cap, N);
+        __len = std::exchange(o.__len, 0);
+        o.__buf[0] = 0;
+      } else {
+        assign(o);
+        o.truncate();
+      }
+      return *this;
+    }
+    constexpr ~SmallString() {
+      __release();
+    }
+
+    constexpr operator std::string_view() const noexcept {
+      return std::string_view{begin(), end()};
+    }
+    // Copies up to N characters, longer strings mark the result as truncated.
+    constexpr FixedString<N> to_fixed_string() const noexcept {
+      return FixedString<N>{std::string_view{*this}};
+    }
+
+    // const functions. This indexes into the string
+    constexpr std::optional<char> operator[](size_t id) const noexcept {
+      if (id > __len) {
+        return std::nullopt;
+      }
+      return std::optional{__data[id]};
+    }
+    constexpr const char *begin() const noexcept {
+      return __data;
+    }
+    constexpr const char *end() const noexcept {
+      return __data + __len;
+    }
+    constexpr const char *cbegin() const noexcept {
+      return begin();
+    }
+    constexpr const char *cend() const noexcept {
+      return end();
+    }
+    constexpr char *begin() noexcept {
+      return __data;
+    }
+    constexpr char *end() noexcept {
+      return __data + __len;
+    }
+    constexpr size_t length() const noexcept {
+      return __len;
+    }
+    constexpr size_t size() const noexcept {
+      return __len;
+    }
+    constexpr size_t capacity() const noexcept {
+      return __cap;
+    }
+    // characters that fit before the next allocation.
+    constexpr size_t empty_space() const noexcept {
+      return __cap - __len;
+    }
+    constexpr bool is_inline() const noexcept {
+      return !__on_heap();
+    }
+    constexpr const char *c_str() const noexcept {
+      return __data;
     }
-    friend constexpr bool operator==(const FixedString<N> &l, const char *r) {
+    constexpr Allocator get_allocator() const noexcept {
+      return __alloc;
+    }
+
+    // Modification Functions
+    constexpr void reserve(size_t cap) {
+      if (cap > __cap) {
+        __grow(cap);
+      }
+    }
+    // Keeps the capacity, see shrink_to_fit.
+    constexpr void truncate() noexcept {
+      __set_length(0);
+    }
+    constexpr void shrink_to_fit() {
+      if (!__on_heap() || __cap == __len) {
+        return;
+      }
+      if (__len <= N) {
+        std::ranges::copy_n(__data, __len + 1, __buf.begin());
+        __release();
+        __data = __buf.data();
+        __cap = N;
+      } else {
+        // __grow would double the capacity, allocate exactly __len instead.
+        char *data = AllocTraits::allocate(__alloc, __len + 1);
+        std::ranges::copy_n(__data, __len + 1, data);
+        __release();
+        __data = data;
+        __cap = __len;
+      }
+    }
+    constexpr char &emplace_back(char c) {
+      if (__len == __cap) {
+        __grow(__cap + 1);
+      }
+      __data[__len] = c;
+      __set_length(__len + 1);
+      return __data[__len - 1];
+    }
+    constexpr char &push_back(char c) {
+      return emplace_back(c);
+    }
+    constexpr SmallString &assign(std::string_view s) {
+      __set_length(0);
+      return append(s);
+    }
+    constexpr SmallString &append(std::string_view s) {
+      reserve(__len + s.length());
+      std::ranges::copy_n(s.begin(), s.length(), end());
+      __set_length(__len + s.length());
+      return *this;
+    }
+    /*
+      Formats into the free space after the current content, the string only grows (and formats a
+      second time) when the output does not fit.
+    */
+    template <class... Args> requires(std::formattable<Args, char> && ...)
+    constexpr void emplace_format(std::format_string<Args...> fmt, Args &&...args) {
+      // std::format never moves from its arguments, forwarding them twice is fine.
+      size_t space = empty_space();
+      auto result = std::format_to_n(
+        end(), static_cast<std::ptrdiff_t>(space), fmt, std::forward<Args>(args)...
+      );
+      size_t written = static_cast<size_t>(result.size);
+      if (written > space) {
+        reserve(__len + written);
+        std::format_to_n(
+          end(), static_cast<std::ptrdiff_t>(written), fmt, std::forward<Args>(args)...
+        );
+      }
+      __set_length(__len + written);
+    }
+    template <std::integral IntType> requires(!std::same_as<IntType, bool>)
+    constexpr SmallString &append_int(IntType value, int base = 10) {
+      return __append_chars([&](char *first, char *last) {
+        return std::to_chars(first, last, value, base);
+      });
+    }
+    template <std::floating_point FloatType> SmallString &append_float(FloatType value) {
+      return __append_chars([&](char *first, char *last) {
+        return std::to_chars(first, last, value);
+      });
+    }
+    template <std::floating_point FloatType>
+    SmallString &append_float(FloatType value, std::chars_format fmt, int precision) {
+      return __append_chars([&](char *first, char *last) {
+        return std::to_chars(first, last, value, fmt, precision);
+      });
+    }
+
+    constexpr std::optional<std::reference_wrapper<char>> operator[](size_t id) noexcept {
+      if (id > __len) {
+        return std::nullopt;
+      }
+      return std::optional{std::ref(__data[id])};
+    }
+
+    constexpr void unsafe_set_length(size_t l) noexcept {
+      if (l <= __cap) {
+        __len = l;
+      }
+    }
+
+    // Search Functions
+    constexpr std::optional<size_t> find(char c, size_t pos = 0) const noexcept {
+      // inline and heap buffers both have at least N + 1 readable bytes.
+      size_t at = string_find_char<N + 1>(__data, __len, pos, c);
+      if (at == __len) {
+        return std::nullopt;
+      }
+      return at;
+    }
+    constexpr std::optional<size_t> find(std::string_view s, size_t pos = 0) const noexcept {
+      if (s.length() > __len || pos > __len - s.length()) {
+        return std::nullopt;
+      }
+      if (s.empty()) {
+        return pos;
+      }
+      size_t last = __len - s.length();
+      while (pos <= last) {
+        size_t at = string_find_char<N + 1>(__data, last + 1, pos, s.front());
+        if (at > last) {
+          return std::nullopt;
+        }
+        if (std::string_view{__data + at, s.length()} == s) {
+          return at;
+        }
+        pos = at + 1;
+      }
+      return std::nullopt;
+    }
+    constexpr bool contains(char c) const noexcept {
+      return find(c).has_value();
+    }
+    constexpr bool contains(std::string_view s) const noexcept {
+      return find(s).has_value();
+    }
+    constexpr bool starts_with(std::string_view s) const noexcept {
+      return std::string_view{*this}.starts_with(s);
+    }
+    constexpr bool ends_with(std::string_view s) const noexcept {
+      return std::string_view{*this}.ends_with(s);
+    }
+    // equal to FixedString::hash for the same characters.
+    constexpr uint64_t hash() const noexcept {
+      return string_word_hash<N + 1>(__data, __len);
+    }
+
+    // Comparison Operator
+    template <size_t N2, class Allocator2>
+    friend constexpr bool operator==(
+      const SmallString &l, const SmallString<N2, Allocator2> &r
+    ) noexcept {
+      return l.length() == r.length() &&
+        string_mismatch<std::min(N, N2) + 1>(l.c_str(), r.c_str(), l.length()) == l.length();
+    }
+    template <size_t N2>
+    friend constexpr bool operator==(const SmallString &l, const FixedString<N2> &r) noexcept {
+      return l.length() == r.length() &&
+        string_mismatch<std::min(N, N2) + 1>(l.c_str(), r.c_str(), l.length()) == l.length();
+    }
+    friend constexpr bool operator==(const SmallString &l, std::string_view r) noexcept {
+      return std::string_view{l} == r;
+    }
+    friend constexpr bool operator==(const SmallString &l, const char *r) noexcept {
       return l == std::string_view{r};
     }
+    template <size_t N2, class Allocator2>
+    friend constexpr std::strong_ordering operator<=>(
+      const SmallString &l, const SmallString<N2, Allocator2> &r
+    ) noexcept {
+      return std::string_view{l} <=> std::string_view{r};
+    }
+    template <size_t N2>
+    friend constexpr std::strong_ordering operator<=>(
+      const SmallString &l, const FixedString<N2> &r
+    ) noexcept {
+      return std::string_view{l} <=> std::string_view{r};
+    }
+    friend constexpr std::strong_ordering operator<=>(
+      const SmallString &l, std::string_view r
+    ) noexcept {
+      return std::string_view{l} <=> r;
+    }
+
+  private:
+    // Converts into the free space and only grows when the characters do not fit.
+    template <class Convert> constexpr SmallString &__append_chars(Convert &&convert) {
+      while (true) {
+        auto [ptr, ec] = convert(end(), __data + __cap);
+        if (ec == std::errc{}) {
+          __set_length(static_cast<size_t>(ptr - __data));
+          return *this;
+        }
+        __grow(__cap * 2);
+      }
+    }
   };
+
+  namespace pmr {
+    export template <size_t N>
+    using SmallString = generic::SmallString<N, std::pmr::polymorphic_allocator<char>>;
+  }
 }
 
 namespace generic = jowi::generic;
@@ -146,6 +768,29 @@ template <size_t N, class CharType> struct std::formatter<generic::FixedString<N
   }
 };
 
+template <size_t N> struct std::hash<generic::FixedString<N>> {
+  constexpr size_t operator()(const generic::FixedString<N> &s) const noexcept {
+    return static_cast<size_t>(s.hash());
+  }
+};
+
+template <size_t N, class Allocator, class CharType>
+struct std::formatter<generic::SmallString<N, Allocator>, CharType> {
+  constexpr auto parse(auto &ctx) {
+    return ctx.begin();
+  }
+  constexpr auto format(const generic::SmallString<N, Allocator> &s, auto &ctx) const {
+    std::format_to(ctx.out(), "{}", std::string_view{s});
+    return ctx.out();
+  }
+};
+
+template <size_t N, class Allocator> struct std::hash<generic::SmallString<N, Allocator>> {
+  constexpr size_t operator()(const generic::SmallString<N, Allocator> &s) const noexcept {
+    return static_cast<size_t>(s.hash());
+  }
+};
+
 /*
   constexpr tests
 */
@@ -154,11 +799,19 @@ namespace jowi::generic {
   static_assert(FixedString{"HELLO"}.length() == 5);
   static_assert(FixedString<7>{"HELLO"}.length() == 5);
   static_assert(FixedString{"HELLO"}[0].value().get() == 'H');
+  static_assert(FixedString{"HELLO"} == FixedString<20>{"HELLO"});
+  static_assert(FixedString{"HELLO"} < FixedString{"HELLP"});
+  static_assert(FixedString<20>{"HELLO WORLD"}.find("WORLD") == 6);
+  static_assert(FixedString<20>{"HELLO WORLD"}.starts_with("HELLO"));
+  static_assert(FixedString<20>{"HELLO"}.hash() == FixedString<40>{"HELLO"}.hash());
 
   constexpr FixedString<20> test_hello_format() {
     FixedString<20> v;
     v.emplace_format("{}", "Hello World");
     return v;
   }
+  static_assert(FixedString<8>{"abc"}.append("defghijk") == "abcdefgh");
+  static_assert(SmallString<4>{"abc"}.append("defghijk") == "abcdefghijk");
+  static_assert(SmallString<4>{"abc"}.is_inline());
 }
 #endif
\ No newline at end of file
@@ -1,7 +1,16 @@
 module;
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
 #include <format>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 export module jowi.generic:is_formattable_error;
+import :fixed_string;
 
 namespace jowi::generic {
   // use DI instead
@@ -9,14 +18,156 @@ namespace jowi::generic {
   concept IsFormattableError = std::formattable<E, char> ||
     requires(const E &e) { std::formattable<decltype(e.what()), char>; };
 
+  // the value formatted in place of e: e itself, or e.what().
+  template <IsFormattableError E> constexpr decltype(auto) error_format_arg(const E &e) {
+    if constexpr (std::formattable<E, char>) {
+      return e;
+    } else {
+      return e.what();
+    }
+  }
+  template <IsFormattableError E, class OutputIt>
+  constexpr OutputIt format_error_to(OutputIt out, const E &e) {
+    return std::format_to(std::move(out), "{}", error_format_arg(e));
+  }
+
   export struct ErrorFormatter {
     std::string msg;
     template <IsFormattableError E> constexpr ErrorFormatter(const E &e) {
-      if constexpr (std::formattable<E, char>) {
-        msg = std::format("{}", e);
+      format_error_to(std::back_inserter(msg), e);
+    }
+  };
+
+  /*
+    LazyErrorFormatter
+    keeps a copy of the error and formats it only when the formatter is invoked. Errors of at most
+    InlineSize bytes are stored inline, larger ones are copied to the heap.
+  */
+  export template <size_t InlineSize = 48> class LazyErrorFormatter {
+    struct Operations {
+      void (*copy)(const void *from, void *to);
+      void (*move)(void *from, void *to) noexcept;
+      void (*destroy)(void *e) noexcept;
+      std::format_context::iterator (*format)(const void *e, std::format_context &ctx);
+    };
+
+    template <class E>
+    static constexpr bool __is_inline = sizeof(E) <= InlineSize &&
+      alignof(E) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<E>;
+
+    template <class E> static const E &__get(const void *buf) noexcept {
+      if constexpr (__is_inline<E>) {
+        return *static_cast<const E *>(buf);
       } else {
-        msg = std::format("{}", e.what());
+        return **static_cast<E *const *>(buf);
+      }
+    }
+    template <class E>
+    static constexpr Operations __operations = {
+      [](const void *from, void *to) {
+        if constexpr (__is_inline<E>) {
+          std::construct_at(static_cast<E *>(to), __get<E>(from));
+        } else {
+          *static_cast<E **>(to) = new E(__get<E>(from));
+        }
+      },
+      [](void *from, void *to) noexcept {
+        if constexpr (__is_inline<E>) {
+          std::construct_at(static_cast<E *>(to), std::move(*static_cast<E *>(from)));
+          std::destroy_at(static_cast<E *>(from));
+        } else {
+          *static_cast<E **>(to) = *static_cast<E **>(from);
+        }
+      },
+      [](void *e) noexcept {
+        if constexpr (__is_inline<E>) {
+          std::destroy_at(static_cast<E *>(e));
+        } else {
+          delete *static_cast<E **>(e);
+        }
+      },
+      [](const void *e, std::format_context &ctx) {
+        return format_error_to(ctx.out(), __get<E>(e));
+      }
+    };
+
+    alignas(std::max_align_t) std::byte __buf[std::max(InlineSize, sizeof(void *))];
+    const Operations *__ops;
+
+    void __destroy() noexcept {
+      if (__ops != nullptr) {
+        __ops->destroy(__buf);
+      }
+    }
+
+  public:
+    template <IsFormattableError E>
+    requires(!std::same_as<E, LazyErrorFormatter> && std::copy_constructible<E>)
+    LazyErrorFormatter(const E &e) : __ops{&__operations<E>} {
+      if constexpr (__is_inline<E>) {
+        std::construct_at(reinterpret_cast<E *>(__buf), e);
+      } else {
+        *reinterpret_cast<E **>(__buf) = new E(e);
+      }
+    }
+    LazyErrorFormatter(const LazyErrorFormatter &o) : __ops{o.__ops} {
+      if (__ops != nullptr) {
+        __ops->copy(o.__buf, __buf);
+      }
+    }
+    // a moved from formatter formats to nothing.
+    LazyErrorFormatter(LazyErrorFormatter &&o) noexcept : __ops{std::exchange(o.__ops, nullptr)} {
+      if (__ops != nullptr) {
+        __ops->move(o.__buf, __buf);
+      }
+    }
+    LazyErrorFormatter &operator=(const LazyErrorFormatter &o) {
+      if (this != &o) {
+        *this = LazyErrorFormatter{o};
+      }
+      return *this;
+    }
+    LazyErrorFormatter &operator=(LazyErrorFormatter &&o) noexcept {
+      if (this != &o) {
+        __destroy();
+        __ops = std::exchange(o.__ops, nullptr);
+        if (__ops != nullptr) {
+          __ops->move(o.__buf, __buf);
+        }
+      }
+      return *this;
+    }
+    ~LazyErrorFormatter() {
+      __destroy();
+    }
+
+    std::format_context::iterator format_to(std::format_context &ctx) const {
+      if (__ops == nullptr) {
+        return ctx.out();
       }
+      return __ops->format(__buf, ctx);
+    }
+    // formats the error into a new string.
+    std::string message() const {
+      return std::format("{}", *this);
+    }
+  };
+
+  /*
+    FixedErrorFormatter
+    ErrorFormatter writing into a FixedString<N>, constructing one never allocates. A message
+    longer than N characters is cut, see truncated.
+  */
+  export template <size_t N = 128> struct FixedErrorFormatter {
+    FixedString<N> msg;
+    template <IsFormattableError E> requires(!std::same_as<E, FixedErrorFormatter>)
+    constexpr FixedErrorFormatter(const E &e) : msg{} {
+      // emplace_format bounds the output by N and records truncation, format_error_to cannot.
+      msg.emplace_format("{}", error_format_arg(e));
+    }
+
+    constexpr bool truncated() const noexcept {
+      return msg.truncated();
     }
   };
 }
@@ -29,3 +180,21 @@ template <class CharType> struct std::formatter<generic::ErrorFormatter, CharTyp
     return std::format_to(ctx.out(), "{}", e.msg);
   }
 };
+// the erased format function writes to a std::format_context, so only char is supported.
+template <size_t InlineSize> struct std::formatter<generic::LazyErrorFormatter<InlineSize>, char> {
+  constexpr auto parse(auto &ctx) {
+    return ctx.begin();
+  }
+  auto format(const generic::LazyErrorFormatter<InlineSize> &e, std::format_context &ctx) const {
+    return e.format_to(ctx);
+  }
+};
+template <size_t N, class CharType>
+struct std::formatter<generic::FixedErrorFormatter<N>, CharType> {
+  constexpr auto parse(auto &ctx) {
+    return ctx.begin();
+  }
+  constexpr auto format(const generic::FixedErrorFormatter<N> &e, auto &ctx) const {
+    return std::format_to(ctx.out(), "{}", std::string_view{e.msg});
+  }
+};
@@ -1,9 +1,26 @@
 module;
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <concepts>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#if defined(__SSE2__)
+  #include <immintrin.h>
+#endif
 export module jowi.generic:key_vector;
 
 namespace jowi::generic {
@@ -11,15 +28,426 @@ namespace jowi::generic {
   concept IsComparable = requires(std::decay_t<ValueType> l, std::decay_t<OtherType> r) {
     { l == r } -> std::same_as<bool>;
   };
-  export template <class KeyType, class ValueType> class KeyVector {
+  // Integer types accepted by std::in_range, i.e. everything integral but bool and the char types.
+  template <class T>
+  concept IsStandardInteger = std::integral<T> && !std::same_as<T, bool> &&
+    !std::same_as<T, char> && !std::same_as<T, wchar_t> && !std::same_as<T, char8_t> &&
+    !std::same_as<T, char16_t> && !std::same_as<T, char32_t>;
+
+  /*
+    32 bit FNV-1a. It is constexpr so that keys known at compile time can be hashed ahead of time.
+  */
+  export constexpr uint32_t string_hash(std::string_view s) noexcept {
+    uint32_t hash = 0x811C'9DC5;
+    for (char c : s) {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 0x0100'0193;
+    }
+    return hash;
+  }
+
+  /*
+    HashedStringView
+    a string view together with its string_hash. Build one once for a key that is looked up
+    repeatedly, it can be passed to any lookup on a HashedString keyed map without hashing again.
+  */
+  export struct HashedStringView {
+    std::string_view value;
+    uint32_t hash;
+
+    constexpr HashedStringView(std::string_view v) noexcept : value{v}, hash{string_hash(v)} {}
+    constexpr HashedStringView(std::string_view v, uint32_t h) noexcept : value{v}, hash{h} {}
+
+    friend constexpr bool operator==(HashedStringView l, HashedStringView r) noexcept {
+      return l.hash == r.hash && l.value == r.value;
+    }
+  };
+
+  /*
+    HashedString
+    a string key that caches its string_hash next to it. Comparing two hashed strings rejects most
+    mismatches with a single integer compare, the map types convert a plain string query into a
+    HashedStringView once per lookup so every probe benefits from it. The key also feeds its cached
+    hash into the KeyVector index.
+  */
+  export template <class StringType = std::string> struct HashedString {
+    StringType value;
+    uint32_t hash;
+
+    template <class S>
+    requires(
+      std::convertible_to<const S &, std::string_view> && std::constructible_from<StringType, S>
+    )
+    constexpr HashedString(S &&s) :
+      value(std::forward<S>(s)), hash{string_hash(std::string_view{value})} {}
+    constexpr explicit HashedString(HashedStringView v) : value(v.value), hash{v.hash} {}
+
+    constexpr operator HashedStringView() const noexcept {
+      return HashedStringView{std::string_view{value}, hash};
+    }
+    constexpr std::string_view view() const noexcept {
+      return std::string_view{value};
+    }
+
+    friend constexpr bool operator==(const HashedString &l, const HashedString &r) noexcept {
+      return l.hash == r.hash && l.view() == r.view();
+    }
+    friend constexpr bool operator==(const HashedString &l, HashedStringView r) noexcept {
+      return l.hash == r.hash && l.view() == r.value;
+    }
+    friend constexpr bool operator==(const HashedString &l, std::string_view r) noexcept {
+      return l.view() == r;
+    }
+  };
+
+  template <class KeyType> constexpr bool is_hashed_string = false;
+  template <class StringType> constexpr bool is_hashed_string<HashedString<StringType>> = true;
+
+  /*
+    Rewrites a query before it is compared against the keys of a map. Plain strings looked up in a
+    HashedString keyed map are hashed here once, everything else is passed through.
+  */
+  template <class KeyType, class Key> constexpr decltype(auto) key_probe(const Key &k) noexcept {
+    if constexpr (is_hashed_string<KeyType> && std::convertible_to<const Key &, std::string_view>) {
+      return HashedStringView{std::string_view{k}};
+    } else {
+      return (k);
+    }
+  }
+
+  /*
+    Hashing used by the KeyVector index. A query can only go through the index if it hashes to the
+    same value as the key it compares equal to, so string like keys are all hashed as string_view
+    and integers are hashed after converting them to the key type. Every other query falls back to
+    a linear scan.
+  */
+  template <class KeyType, class Key>
+  requires(
+    std::convertible_to<const KeyType &, std::string_view> &&
+    std::convertible_to<const Key &, std::string_view>
+  )
+  size_t key_hash(const Key &k) noexcept {
+    return std::hash<std::string_view>{}(std::string_view{k});
+  }
+  template <class KeyType, class Key>
+  requires(
+    !std::convertible_to<const KeyType &, std::string_view> &&
+    (std::same_as<Key, KeyType> || (IsStandardInteger<KeyType> && IsStandardInteger<Key>)) &&
+    requires(const KeyType &k) { std::hash<KeyType>{}(k); }
+  )
+  size_t key_hash(const Key &k) noexcept {
+    return std::hash<KeyType>{}(static_cast<KeyType>(k));
+  }
+  template <class KeyType, class Key>
+  requires(is_hashed_string<KeyType> &&
+           (std::same_as<Key, KeyType> || std::same_as<Key, HashedStringView>))
+  size_t key_hash(const Key &k) noexcept {
+    return k.hash;
+  }
+
+  template <class KeyType, class Key>
+  concept IsHashableWith = requires(const Key &k) {
+    { key_hash<KeyType>(k) } -> std::same_as<size_t>;
+  };
+
+  /*
+    random access iterator over a vector of key value pairs that yields pair<const Key &, Value &>
+    by value. Writing a key through the iterators of an indexed or sorted container would break
+    its lookups. As the reference is a proxy, bind it with auto or auto && rather than auto &.
+  */
+  template <class BaseIterator> struct ConstKeyIterator {
+    using EntryType = std::iter_value_t<BaseIterator>;
+    using value_type = EntryType;
+    using reference =
+      std::pair<const typename EntryType::first_type &, typename EntryType::second_type &>;
+    using difference_type = std::ptrdiff_t;
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+
+    // operator-> of a proxy reference.
+    struct ArrowProxy {
+      reference ref;
+      constexpr const reference *operator->() const noexcept {
+        return &ref;
+      }
+    };
+
+    BaseIterator it;
+
+    constexpr reference operator*() const noexcept {
+      return reference{it->first, it->second};
+    }
+    constexpr ArrowProxy operator->() const noexcept {
+      return ArrowProxy{**this};
+    }
+    constexpr reference operator[](difference_type n) const noexcept {
+      return *(*this + n);
+    }
+    constexpr ConstKeyIterator &operator++() noexcept {
+      ++it;
+      return *this;
+    }
+    constexpr ConstKeyIterator operator++(int) noexcept {
+      ConstKeyIterator copy = *this;
+      ++it;
+      return copy;
+    }
+    constexpr ConstKeyIterator &operator--() noexcept {
+      --it;
+      return *this;
+    }
+    constexpr ConstKeyIterator operator--(int) noexcept {
+      ConstKeyIterator copy = *this;
+      --it;
+      return copy;
+    }
+    constexpr ConstKeyIterator &operator+=(difference_type n) noexcept {
+      it += n;
+      return *this;
+    }
+    constexpr ConstKeyIterator &operator-=(difference_type n) noexcept {
+      it -= n;
+      return *this;
+    }
+    friend constexpr ConstKeyIterator operator+(ConstKeyIterator i, difference_type n) noexcept {
+      return i += n;
+    }
+    friend constexpr ConstKeyIterator operator+(difference_type n, ConstKeyIterator i) noexcept {
+      return i += n;
+    }
+    friend constexpr ConstKeyIterator operator-(ConstKeyIterator i, difference_type n) noexcept {
+      return i -= n;
+    }
+    friend constexpr difference_type operator-(
+      const ConstKeyIterator &l, const ConstKeyIterator &r
+    ) noexcept {
+      return l.it - r.it;
+    }
+    friend constexpr bool operator==(
+      const ConstKeyIterator &l, const ConstKeyIterator &r
+    ) noexcept {
+      return l.it == r.it;
+    }
+    friend constexpr auto operator<=>(
+      const ConstKeyIterator &l, const ConstKeyIterator &r
+    ) noexcept {
+      return l.it <=> r.it;
+    }
+  };
+
+  /*
+    KeyIndex
+    open addressing table mapping a key hash to a position in the KeyVector storage. Slots are 1, 2
+    or 4 bytes wide depending on the table capacity and store position + 1, 0 marks an empty slot.
+    The table is kept at most half full so that linear probing stays short. The slots are
+    allocated with the allocator of the owning KeyVector.
+  */
+  template <class Allocator> class KeyIndex {
+    using SlotAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char>;
+    std::vector<unsigned char, SlotAllocator> __slots;
+    uint8_t __width;
+    uint8_t __bits;
+    size_t __count;
+
+    size_t __slot(size_t i) const noexcept {
+      if (__width == 1) {
+        return __slots[i];
+      } else if (__width == 2) {
+        uint16_t v;
+        std::memcpy(&v, __slots.data() + i * 2, 2);
+        return v;
+      } else {
+        uint32_t v;
+        std::memcpy(&v, __slots.data() + i * 4, 4);
+        return v;
+      }
+    }
+    void __set_slot(size_t i, size_t value) noexcept {
+      if (__width == 1) {
+        __slots[i] = static_cast<unsigned char>(value);
+      } else if (__width == 2) {
+        uint16_t v = static_cast<uint16_t>(value);
+        std::memcpy(__slots.data() + i * 2, &v, 2);
+      } else {
+        uint32_t v = static_cast<uint32_t>(value);
+        std::memcpy(__slots.data() + i * 4, &v, 4);
+      }
+    }
+    size_t __home(size_t hash) const noexcept {
+      // Fibonacci hashing, std::hash is the identity for integers on most standard libraries.
+      uint64_t h = static_cast<uint64_t>(hash) * 0x9E37'79B9'7F4A'7C15ull;
+      return static_cast<size_t>(h >> (64 - __bits));
+    }
+    size_t __mask() const noexcept {
+      return (size_t{1} << __bits) - 1;
+    }
+
+  public:
+    constexpr KeyIndex(const Allocator &a = Allocator{}) noexcept :
+      __slots(SlotAllocator{a}), __width{0}, __bits{0}, __count{0} {}
+
+    // true once the table has been sized by reset, even while it holds no position yet.
+    constexpr bool active() const noexcept {
+      return __bits != 0;
+    }
+    size_t capacity() const noexcept {
+      return __bits == 0 ? 0 : size_t{1} << __bits;
+    }
+
+    /*
+      Drops every slot and sizes the table for n positions. The slot width is the smallest that
+      can hold every position the table may contain before it has to grow.
+    */
+    void reset(size_t n) {
+      // allocated before any member changes, a throwing allocation leaves the table untouched.
+      uint8_t bits = std::max<uint8_t>(4, static_cast<uint8_t>(std::bit_width(n * 2)));
+      size_t cap = size_t{1} << bits;
+      uint8_t width = cap <= 0xFF ? 1 : cap <= 0xFFFF ? 2 : 4;
+      std::vector<unsigned char, SlotAllocator> slots(cap * width, 0, __slots.get_allocator());
+      __slots = std::move(slots);
+      __bits = bits;
+      __width = width;
+      __count = 0;
+    }
+    constexpr void clear() noexcept {
+      __slots.clear();
+      __width = 0;
+      __bits = 0;
+      __count = 0;
+    }
+    bool can_hold(size_t n) const noexcept {
+      return n * 2 <= capacity();
+    }
+    bool needs_grow() const noexcept {
+      return !can_hold(__count + 1);
+    }
+    void insert(size_t hash, size_t pos) noexcept {
+      size_t i = __home(hash);
+      while (__slot(i) != 0) {
+        i = (i + 1) & __mask();
+      }
+      __set_slot(i, pos + 1);
+      __count += 1;
+    }
+    /*
+      Walks the probe sequence of hash and returns the first position for which is_match returns
+      true.
+    */
+    template <class F> std::optional<size_t> find(size_t hash, F &&is_match) const {
+      for (size_t i = __home(hash);; i = (i + 1) & __mask()) {
+        size_t slot = __slot(i);
+        if (slot == 0) {
+          return std::nullopt;
+        }
+        if (is_match(slot - 1)) {
+          return slot - 1;
+        }
+      }
+    }
+  };
+
+  /*
+    KeyVector
+    an insertion ordered map backed by a flat vector. Small maps are scanned linearly, once the map
+    holds IndexThreshold entries a hash index over the vector positions is built so that lookups
+    stay O(1) at any size. Iteration order and reference stability are those of the vector.
+    The mutable iterators are random access and hand out pair<const Key &, Value &> by value, only
+    the values can be written through them. Unlike a plain vector iterator the reference is a
+    proxy: `for (auto &[k, v] : kv)` has to become `for (auto [k, v] : kv)`.
+    Every allocation, including the one of the index, goes through Allocator.
+  */
+  export template <
+    class KeyType,
+    class ValueType,
+    size_t IndexThreshold = 32,
+    class Allocator = std::allocator<std::pair<KeyType, ValueType>>>
+  class KeyVector {
     using EntryType = std::pair<KeyType, ValueType>;
-    using ContainerType = std::vector<EntryType>;
+    using ContainerType = std::vector<EntryType, Allocator>;
     ContainerType __values;
+    KeyIndex<Allocator> __index;
+
+    static constexpr bool is_indexable = IsHashableWith<KeyType, KeyType>;
+
+    template <class Key> constexpr size_t __find(const Key &k) const noexcept {
+      const auto &probe = key_probe<KeyType>(k);
+      if constexpr (IsHashableWith<KeyType, std::decay_t<decltype(probe)>>) {
+        if (!std::is_constant_evaluated() && __index.active()) {
+          auto is_match = [&](size_t pos) { return __values[pos].first == probe; };
+          return __index.find(key_hash<KeyType>(probe), is_match).value_or(__values.size());
+        }
+      }
+      auto it =
+        std::ranges::find_if(__values, [&](const EntryType &e) { return e.first == probe; });
+      return it - __values.begin();
+    }
+    // expected sizes the table for a batch that is about to be appended.
+    constexpr void __rebuild_index(size_t expected = 0) {
+      if constexpr (is_indexable) {
+        if (std::is_constant_evaluated()) {
+          return;
+        }
+        expected = std::max(expected, __values.size());
+        if (expected < IndexThreshold) {
+          __index.clear();
+          return;
+        }
+        __index.reset(expected);
+        for (size_t pos = 0; pos < __values.size(); pos += 1) {
+          __index.insert(key_hash<KeyType>(__values[pos].first), pos);
+        }
+      }
+    }
+    constexpr void __index_back() {
+      if constexpr (is_indexable) {
+        if (std::is_constant_evaluated()) {
+          return;
+        }
+        if (!__index.active() || __index.needs_grow()) {
+          __rebuild_index();
+        } else {
+          __index.insert(key_hash<KeyType>(__values.back().first), __values.size() - 1);
+        }
+      }
+    }
+    template <class Self, class Key, size_t Extent, class ResultContainer>
+    static constexpr void __get_many(
+      Self &self, std::span<Key, Extent> keys, ResultContainer &out
+    ) {
+      if constexpr (IsHashableWith<KeyType, std::remove_cv_t<Key>>) {
+        if (!std::is_constant_evaluated() && self.__index.active()) {
+          for (size_t i = 0; i < keys.size(); i += 1) {
+            if (size_t pos = self.__find(keys[i]); pos != self.__values.size()) {
+              out[i].emplace(self.__values[pos].second);
+            }
+          }
+          return;
+        }
+      }
+      // A single pass over the entries, each entry is compared against the unresolved keys.
+      size_t remaining = keys.size();
+      for (size_t pos = 0; pos < self.__values.size() && remaining != 0; pos += 1) {
+        for (size_t i = 0; i < keys.size(); i += 1) {
+          if (!out[i].has_value() && self.__values[pos].first == keys[i]) {
+            out[i].emplace(self.__values[pos].second);
+            remaining -= 1;
+          }
+        }
+      }
+    }
 
   public:
-    constexpr KeyVector() : __values{} {}
-    constexpr KeyVector(ContainerType container) : __values{std::move(container)} {}
-    constexpr KeyVector(std::initializer_list<std::pair<KeyType, ValueType>> list) {
+    using AllocatorType = Allocator;
+
+    constexpr KeyVector() : __values{}, __index{} {}
+    constexpr explicit KeyVector(const Allocator &a) : __values(a), __index{a} {}
+    constexpr KeyVector(ContainerType container) :
+      __values{std::move(container)}, __index{__values.get_allocator()} {
+      __rebuild_index();
+    }
+    constexpr KeyVector(
+      std::initializer_list<std::pair<KeyType, ValueType>> list, const Allocator &a = Allocator{}
+    ) : KeyVector(a) {
       __values.reserve(list.size());
       for (auto &&[key, value] : list) {
         insert(std::move(key), std::move(value));
@@ -31,20 +459,20 @@ namespace jowi::generic {
     */
     template <IsComparable<KeyType> Key>
     constexpr std::optional<std::reference_wrapper<const ValueType>> get(Key &&k) const noexcept {
-      auto it = std::ranges::find(__values, std::forward<Key>(k), &EntryType::first);
-      if (it == __values.end()) {
+      size_t pos = __find(k);
+      if (pos == __values.size()) {
         return std::nullopt;
       } else {
-        return std::cref(it->second);
+        return std::cref(__values[pos].second);
       }
     }
     template <IsComparable<KeyType> Key>
     constexpr std::optional<std::reference_wrapper<ValueType>> get(Key &&k) noexcept {
-      auto it = std::ranges::find(__values, std::forward<Key>(k), &EntryType::first);
-      if (it == __values.end()) {
+      size_t pos = __find(k);
+      if (pos == __values.size()) {
         return std::nullopt;
       } else {
-        return std::ref(it->second);
+        return std::ref(__values[pos].second);
       }
     }
     template <IsComparable<KeyType> Key>
@@ -58,39 +486,132 @@ namespace jowi::generic {
       return get(std::forward<Key>(key));
     }
 
+    /*
+      batch getters. Looks up every key in one call, the result at index i belongs to keys[i]. A
+      fixed extent span returns an std::array, a dynamic one an std::vector.
+    */
+    template <class Key, size_t Extent> requires(IsComparable<Key, KeyType>)
+    constexpr auto get_many(std::span<Key, Extent> keys) const {
+      using ResultType = std::optional<std::reference_wrapper<const ValueType>>;
+      if constexpr (Extent == std::dynamic_extent) {
+        std::vector<ResultType> out(keys.size());
+        __get_many(*this, keys, out);
+        return out;
+      } else {
+        std::array<ResultType, Extent> out{};
+        __get_many(*this, keys, out);
+        return out;
+      }
+    }
+    template <class Key, size_t Extent> requires(IsComparable<Key, KeyType>)
+    constexpr auto get_many(std::span<Key, Extent> keys) {
+      using ResultType = std::optional<std::reference_wrapper<ValueType>>;
+      if constexpr (Extent == std::dynamic_extent) {
+        std::vector<ResultType> out(keys.size());
+        __get_many(*this, keys, out);
+        return out;
+      } else {
+        std::array<ResultType, Extent> out{};
+        __get_many(*this, keys, out);
+        return out;
+      }
+    }
+
     /*
       element inserts
     */
     template <IsComparable<KeyType> Key, class... Args>
     requires(std::is_constructible_v<KeyType, Key> && std::is_constructible_v<ValueType, Args...>)
     constexpr ValueType &emplace(Key &&key, Args &&...args) {
-      auto it = std::ranges::find(__values, key, &EntryType::first);
-      if (it != __values.end()) {
-        it->second = ValueType{std::forward<Args>(args)...};
-        return it->second;
+      size_t pos = __find(key);
+      if (pos != __values.size()) {
+        __values[pos].second = ValueType{std::forward<Args>(args)...};
+        return __values[pos].second;
       } else {
-        return __values
-          .emplace_back(KeyType{std::forward<Key>(key)}, ValueType{std::forward<Args>(args)...})
-          .second;
+        __values.emplace_back(
+          KeyType{std::forward<Key>(key)}, ValueType{std::forward<Args>(args)...}
+        );
+        try {
+          __index_back();
+        } catch (...) {
+          // the entry is not indexed, keep the map as it was.
+          __values.pop_back();
+          throw;
+        }
+        return __values.back().second;
       }
     }
     constexpr ValueType &insert(const KeyType &key, ValueType value) {
       return emplace(key, std::move(value));
     }
+    /*
+      Inserts every (key, value) pair of entries, a later duplicate replaces the earlier value just
+      like insert would. For sized ranges the storage is reserved once and, when the batch takes
+      the map past IndexThreshold, the index is built for the final size up front so that every
+      duplicate check is a single probe.
+    */
+    template <std::ranges::input_range R>
+    requires(std::is_constructible_v<EntryType, std::ranges::range_value_t<R>>)
+    constexpr void insert_range(R &&entries) {
+      if constexpr (std::ranges::sized_range<R>) {
+        size_t expected = __values.size() + std::ranges::size(entries);
+        __values.reserve(expected);
+        if (!__index.active() || !__index.can_hold(expected)) {
+          __rebuild_index(expected);
+        }
+      }
+      for (auto &&entry : entries) {
+        emplace(
+          std::get<0>(std::forward<decltype(entry)>(entry)),
+          std::get<1>(std::forward<decltype(entry)>(entry))
+        );
+      }
+    }
     template <IsComparable<KeyType> Key> constexpr std::optional<ValueType> remove(Key &&key) {
-      auto it = std::ranges::find(__values, std::forward<Key>(key), &EntryType::first);
-      if (it == __values.end()) {
+      size_t pos = __find(key);
+      if (pos == __values.size()) {
         return std::nullopt;
       } else {
-        ValueType value = std::move(it->second);
-        __values.erase(it);
+        ValueType value = std::move(__values[pos].second);
+        __values.erase(__values.begin() + pos);
+        // erase shifts every following position, the index has to be rebuilt either way.
+        if (__index.active()) {
+          __rebuild_index();
+        }
         return std::optional{std::move(value)};
       }
     }
+    /*
+      Removes every entry for which pred(key, value) returns true by compacting the storage in a
+      single pass. Returns the number of removed entries.
+    */
+    template <class Predicate>
+    requires(std::predicate<Predicate &, const KeyType &, ValueType &>)
+    constexpr size_t remove_if(Predicate &&pred) {
+      size_t removed = std::erase_if(__values, [&](EntryType &entry) {
+        return std::invoke(pred, std::as_const(entry.first), entry.second);
+      });
+      if (removed != 0 && __index.active()) {
+        __rebuild_index();
+      }
+      return removed;
+    }
 
     constexpr size_t size() const noexcept {
       return __values.size();
     }
+    constexpr size_t capacity() const noexcept {
+      return __values.capacity();
+    }
+    constexpr void reserve(size_t n) {
+      __values.reserve(n);
+    }
+    constexpr bool is_indexed() const noexcept {
+      return __index.active();
+    }
+    constexpr Allocator get_allocator() const noexcept {
+      return __values.get_allocator();
+    }
 
     constexpr auto begin() const noexcept {
       return __values.begin();
@@ -98,11 +619,12 @@ namespace jowi::generic {
     constexpr auto end() const noexcept {
       return __values.end();
     }
+    // keys are const, the values can be written.
     constexpr auto begin() noexcept {
-      return __values.begin();
+      return ConstKeyIterator{__values.begin()};
     }
     constexpr auto end() noexcept {
-      return __values.end();
+      return ConstKeyIterator{__values.end()};
     }
     constexpr bool empty() const noexcept {
       return __values.empty();
@@ -112,4 +634,547 @@ namespace jowi::generic {
       return std::ranges::transform_view{__values, &EntryType::first};
     }
   };
+
+  namespace pmr {
+    export template <class KeyType, class ValueType, size_t IndexThreshold = 32>
+    using KeyVector = generic::KeyVector<
+      KeyType,
+      ValueType,
+      IndexThreshold,
+      std::pmr::polymorphic_allocator<std::pair<KeyType, ValueType>>>;
+  }
+
+  template <class EntryType, size_t N> struct InlineKeyVectorBuffer {
+    alignas(EntryType) std::byte __buf[N * sizeof(EntryType)];
+    std::pmr::monotonic_buffer_resource __resource;
+
+    InlineKeyVectorBuffer() noexcept :
+      __resource{__buf, sizeof(__buf), std::pmr::new_delete_resource()} {}
+  };
+
+  /*
+    InlineKeyVector
+    a pmr::KeyVector whose first N entries live inside the object. Storage for N entries is reserved
+    from an inline buffer on construction, only growing past N (or building the index) goes to the
+    heap. The buffer is monotonic, memory released by growing is only reclaimed when the
+    InlineKeyVector is destroyed. Copies and moves never share the buffer, they copy or move the
+    entries into their own.
+  */
+  export template <class KeyType, class ValueType, size_t N, size_t IndexThreshold = 32>
+  class InlineKeyVector : private InlineKeyVectorBuffer<std::pair<KeyType, ValueType>, N>,
+                          public pmr::KeyVector<KeyType, ValueType, IndexThreshold> {
+    using BufferType = InlineKeyVectorBuffer<std::pair<KeyType, ValueType>, N>;
+    using BaseType = pmr::KeyVector<KeyType, ValueType, IndexThreshold>;
+
+  public:
+    InlineKeyVector() : BufferType{}, BaseType{&this->__resource} {
+      BaseType::reserve(N);
+    }
+    InlineKeyVector(std::initializer_list<std::pair<KeyType, ValueType>> list) : InlineKeyVector() {
+      for (auto &&[key, value] : list) {
+        BaseType::insert(std::move(key), std::move(value));
+      }
+    }
+    // polymorphic_allocator never propagates, assigning through the base copies the entries into
+    // this object's own buffer.
+    InlineKeyVector(const InlineKeyVector &o) : InlineKeyVector() {
+      BaseType::operator=(o);
+    }
+    InlineKeyVector(InlineKeyVector &&o) : InlineKeyVector() {
+      BaseType::operator=(std::move(o));
+    }
+    InlineKeyVector &operator=(const InlineKeyVector &o) {
+      BaseType::operator=(o);
+      return *this;
+    }
+    InlineKeyVector &operator=(InlineKeyVector &&o) {
+      BaseType::operator=(std::move(o));
+      return *this;
+    }
+    // true while every entry is still stored in the inline buffer.
+    bool is_inline() const noexcept {
+      auto *first = reinterpret_cast<const std::byte *>(std::to_address(BaseType::begin()));
+      return first == this->__buf;
+    }
+  };
+
+  /*
+    Key scanning kernel. Integral keys of 1, 2, 4 or 8 bytes are compared a full vector register
+    at a time (32 bytes with AVX2, 16 bytes with SSE), everything else falls back to a scalar scan.
+    Returns the index of the first match or keys.size() if there is none.
+  */
+  template <class KeyType>
+  concept IsSimdKey = std::integral<KeyType> &&
+    (sizeof(KeyType) == 1 || sizeof(KeyType) == 2 || sizeof(KeyType) == 4 || sizeof(KeyType) == 8);
+
+  template <class KeyType, class Key>
+  constexpr size_t scalar_find_key(std::span<const KeyType> keys, const Key &k) noexcept {
+    for (size_t i = 0; i < keys.size(); i += 1) {
+      if (keys[i] == k) {
+        return i;
+      }
+    }
+    return keys.size();
+  }
+
+#if defined(__SSE2__)
+  template <size_t Width> int simd_match_mask(__m128i l, __m128i r) noexcept {
+    if constexpr (Width == 1) {
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(l, r));
+    } else if constexpr (Width == 2) {
+      return _mm_movemask_epi8(_mm_cmpeq_epi16(l, r));
+    } else if constexpr (Width == 4) {
+      return _mm_movemask_epi8(_mm_cmpeq_epi32(l, r));
+    } else {
+      // SSE2 has no 64 bit compare, a lane matches when both of its 32 bit halves match.
+      __m128i eq = _mm_cmpeq_epi32(l, r);
+      return _mm_movemask_epi8(_mm_and_si128(eq, _mm_shuffle_epi32(eq, 0b10'11'00'01)));
+    }
+  }
+
+  template <class KeyType> __m128i simd_broadcast_128(KeyType k) noexcept {
+    if constexpr (sizeof(KeyType) == 1) {
+      return _mm_set1_epi8(static_cast<char>(k));
+    } else if constexpr (sizeof(KeyType) == 2) {
+      return _mm_set1_epi16(static_cast<short>(k));
+    } else if constexpr (sizeof(KeyType) == 4) {
+      return _mm_set1_epi32(static_cast<int>(k));
+    } else {
+      return _mm_set1_epi64x(static_cast<long long>(k));
+    }
+  }
+#endif
+
+#if defined(__AVX2__)
+  template <size_t Width> int simd_match_mask(__m256i l, __m256i r) noexcept {
+    if constexpr (Width == 1) {
+      return _mm256_movemask_epi8(_mm256_cmpeq_epi8(l, r));
+    } else if constexpr (Width == 2) {
+      return _mm256_movemask_epi8(_mm256_cmpeq_epi16(l, r));
+    } else if constexpr (Width == 4) {
+      return _mm256_movemask_epi8(_mm256_cmpeq_epi32(l, r));
+    } else {
+      return _mm256_movemask_epi8(_mm256_cmpeq_epi64(l, r));
+    }
+  }
+
+  template <class KeyType> __m256i simd_broadcast_256(KeyType k) noexcept {
+    if constexpr (sizeof(KeyType) == 1) {
+      return _mm256_set1_epi8(static_cast<char>(k));
+    } else if constexpr (sizeof(KeyType) == 2) {
+      return _mm256_set1_epi16(static_cast<short>(k));
+    } else if constexpr (sizeof(KeyType) == 4) {
+      return _mm256_set1_epi32(static_cast<int>(k));
+    } else {
+      return _mm256_set1_epi64x(static_cast<long long>(k));
+    }
+  }
+#endif
+
+  template <IsSimdKey KeyType>
+  size_t simd_find_key(std::span<const KeyType> keys, KeyType k) noexcept {
+    const KeyType *data = keys.data();
+    size_t i = 0;
+#if defined(__AVX2__)
+    constexpr size_t lanes_256 = 32 / sizeof(KeyType);
+    __m256i needle_256 = simd_broadcast_256(k);
+    for (; i + lanes_256 <= keys.size(); i += lanes_256) {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+      int mask = simd_match_mask<sizeof(KeyType)>(block, needle_256);
+      if (mask != 0) {
+        return i + std::countr_zero(static_cast<uint32_t>(mask)) / sizeof(KeyType);
+      }
+    }
+#endif
+#if defined(__SSE2__)
+    constexpr size_t lanes_128 = 16 / sizeof(KeyType);
+    __m128i needle_128 = simd_broadcast_128(k);
+    for (; i + lanes_128 <= keys.size(); i += lanes_128) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+      int mask = simd_match_mask<sizeof(KeyType)>(block, needle_128);
+      if (mask != 0) {
+        return i + std::countr_zero(static_cast<uint32_t>(mask)) / sizeof(KeyType);
+      }
+    }
+#endif
+    return i + scalar_find_key(keys.subspan(i), k);
+  }
+
+  template <class KeyType, IsComparable<KeyType> Key>
+  constexpr size_t find_key(std::span<const KeyType> keys, const Key &k) noexcept {
+    using QueryType = std::decay_t<Key>;
+    if constexpr (IsSimdKey<KeyType> && std::same_as<QueryType, KeyType>) {
+      if (std::is_constant_evaluated()) {
+        return scalar_find_key(keys, k);
+      }
+      return simd_find_key(keys, k);
+    } else if constexpr (IsSimdKey<KeyType> && IsStandardInteger<KeyType> &&
+                         IsStandardInteger<QueryType>) {
+      if (std::is_constant_evaluated()) {
+        return scalar_find_key(keys, k);
+      }
+      // A query that does not fit in the key type can never compare equal to a key.
+      if (!std::in_range<KeyType>(k)) {
+        return keys.size();
+      }
+      return simd_find_key(keys, static_cast<KeyType>(k));
+    } else {
+      return scalar_find_key(keys, k);
+    }
+  }
+
+  /*
+    SplitKeyVector
+    Same interface as KeyVector, but the keys and the values live in two separate contiguous
+    arrays. A lookup only walks the key array, so the values never enter the cache until a match is
+    found and integral keys are scanned with the SIMD kernel above.
+  */
+  export template <class KeyType, class ValueType> class SplitKeyVector {
+    using EntryType = std::pair<KeyType, ValueType>;
+    using ContainerType = std::vector<EntryType>;
+    std::vector<KeyType> __keys;
+    std::vector<ValueType> __values;
+
+    template <class KeyIterator, class ValueIterator> struct Iterator {
+      using value_type = EntryType;
+      using reference =
+        std::pair<std::iter_reference_t<KeyIterator>, std::iter_reference_t<ValueIterator>>;
+      using difference_type = std::ptrdiff_t;
+
+      KeyIterator key_it;
+      ValueIterator value_it;
+
+      constexpr reference operator*() const noexcept {
+        return reference{*key_it, *value_it};
+      }
+      constexpr Iterator &operator++() noexcept {
+        ++key_it;
+        ++value_it;
+        return *this;
+      }
+      constexpr Iterator operator++(int) noexcept {
+        Iterator it = *this;
+        ++(*this);
+        return it;
+      }
+      friend constexpr bool operator==(const Iterator &l, const Iterator &r) noexcept {
+        return l.key_it == r.key_it;
+      }
+    };
+
+    using ConstIterator = Iterator<
+      typename std::vector<KeyType>::const_iterator,
+      typename std::vector<ValueType>::const_iterator>;
+    using MutableIterator = Iterator<
+      typename std::vector<KeyType>::const_iterator,
+      typename std::vector<ValueType>::iterator>;
+
+    template <class Key> constexpr std::optional<size_t> __find(const Key &k) const noexcept {
+      size_t id = find_key(std::span<const KeyType>{__keys}, key_probe<KeyType>(k));
+      if (id == __keys.size()) {
+        return std::nullopt;
+      }
+      return id;
+    }
+
+  public:
+    constexpr SplitKeyVector() : __keys{}, __values{} {}
+    constexpr SplitKeyVector(ContainerType container) {
+      __keys.reserve(container.size());
+      __values.reserve(container.size());
+      for (auto &[key, value] : container) {
+        __keys.emplace_back(std::move(key));
+        __values.emplace_back(std::move(value));
+      }
+    }
+    constexpr SplitKeyVector(std::initializer_list<EntryType> list) {
+      __keys.reserve(list.size());
+      __values.reserve(list.size());
+      for (auto &&[key, value] : list) {
+        insert(std::move(key), std::move(value));
+      }
+    }
+
+    /*
+      element getters.
+    */
+    template <IsComparable<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<const ValueType>> get(Key &&k) const noexcept {
+      return __find(k).transform([&](size_t id) { return std::cref(__values[id]); });
+    }
+    template <IsComparable<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<ValueType>> get(Key &&k) noexcept {
+      return __find(k).transform([&](size_t id) { return std::ref(__values[id]); });
+    }
+    template <IsComparable<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<const ValueType>> operator[](
+      Key &&key
+    ) const noexcept {
+      return get(std::forward<Key>(key));
+    }
+    template <IsComparable<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<ValueType>> operator[](Key &&key) noexcept {
+      return get(std::forward<Key>(key));
+    }
+
+    /*
+      element inserts
+    */
+    template <IsComparable<KeyType> Key, class... Args>
+    requires(std::is_constructible_v<KeyType, Key> && std::is_constructible_v<ValueType, Args...>)
+    constexpr ValueType &emplace(Key &&key, Args &&...args) {
+      if (auto id = __find(key); id) {
+        __values[*id] = ValueType{std::forward<Args>(args)...};
+        return __values[*id];
+      }
+      // a key is only added once its value exists, the two arrays never get out of step.
+      ValueType &value = __values.emplace_back(std::forward<Args>(args)...);
+      try {
+        __keys.emplace_back(std::forward<Key>(key));
+      } catch (...) {
+        __values.pop_back();
+        throw;
+      }
+      return value;
+    }
+    constexpr ValueType &insert(const KeyType &key, ValueType value) {
+      return emplace(key, std::move(value));
+    }
+    template <IsComparable<KeyType> Key> constexpr std::optional<ValueType> remove(Key &&key) {
+      auto id = __find(key);
+      if (!id) {
+        return std::nullopt;
+      }
+      ValueType value = std::move(__values[*id]);
+      __keys.erase(__keys.begin() + *id);
+      __values.erase(__values.begin() + *id);
+      return std::optional{std::move(value)};
+    }
+
+    constexpr size_t size() const noexcept {
+      return __keys.size();
+    }
+    constexpr bool empty() const noexcept {
+      return __keys.empty();
+    }
+    constexpr void reserve(size_t n) {
+      __keys.reserve(n);
+      __values.reserve(n);
+    }
+
+    constexpr auto begin() const noexcept {
+      return ConstIterator{__keys.begin(), __values.begin()};
+    }
+    constexpr auto end() const noexcept {
+      return ConstIterator{__keys.end(), __values.end()};
+    }
+    constexpr auto begin() noexcept {
+      return MutableIterator{__keys.cbegin(), __values.begin()};
+    }
+    constexpr auto end() noexcept {
+      return MutableIterator{__keys.cend(), __values.end()};
+    }
+
+    constexpr std::span<const KeyType> keys() const noexcept {
+      return __keys;
+    }
+    constexpr std::span<const ValueType> values() const noexcept {
+      return __values;
+    }
+    constexpr std::span<ValueType> values() noexcept {
+      return __values;
+    }
+  };
+
+  /*
+    Search layouts for SortedKeyVector. binary runs a branchless binary search over the sorted
+    entries, eytzinger additionally keeps a copy of the keys in breadth first (Eytzinger) order so
+    that the search walks memory front to back and the top of the tree stays in cache.
+  */
+  export enum struct SortedLayout { binary, eytzinger };
+
+  export template <class KeyType, class OtherType>
+  concept IsOrderedWith =
+    std::totally_ordered_with<std::decay_t<KeyType>, std::decay_t<OtherType>>;
+
+  /*
+    SortedKeyVector
+    a flat map that keeps its entries sorted by key. It is meant for read heavy maps that are built
+    once, constructing from an unsorted container sorts once instead of probing on every insert.
+    When the container holds the same key more than once, the last entry wins just like it would
+    with successive emplace calls.
+  */
+  export template <
+    std::totally_ordered KeyType,
+    class ValueType,
+    SortedLayout Layout = SortedLayout::binary>
+  class SortedKeyVector {
+    using EntryType = std::pair<KeyType, ValueType>;
+    using ContainerType = std::vector<EntryType>;
+    ContainerType __values;
+    // Eytzinger layout only. Both arrays are 1 indexed, __tree_pos maps a tree node to its position
+    // in __values.
+    std::vector<KeyType> __tree_keys;
+    std::vector<uint32_t> __tree_pos;
+
+    constexpr size_t __build_tree(size_t sorted_pos, size_t node) {
+      if (node <= __values.size()) {
+        sorted_pos = __build_tree(sorted_pos, node * 2);
+        __tree_keys[node] = __values[sorted_pos].first;
+        __tree_pos[node] = static_cast<uint32_t>(sorted_pos);
+        sorted_pos = __build_tree(sorted_pos + 1, node * 2 + 1);
+      }
+      return sorted_pos;
+    }
+    constexpr void __rebuild_tree() {
+      if constexpr (Layout == SortedLayout::eytzinger) {
+        __tree_keys.resize(__values.size() + 1);
+        __tree_pos.resize(__values.size() + 1);
+        __build_tree(0, 1);
+      }
+    }
+
+    // Position of the first entry whose key is not less than k.
+    template <class Key> constexpr size_t __lower_bound(const Key &k) const noexcept {
+      if (__values.empty()) {
+        return 0;
+      }
+      if constexpr (Layout == SortedLayout::eytzinger) {
+        size_t node = 1;
+        while (node <= __values.size()) {
+          node = node * 2 + static_cast<size_t>(__tree_keys[node] < k);
+        }
+        // Undo the trailing right turns, the remaining node is the lower bound.
+        node >>= std::countr_one(node) + 1;
+        return node == 0 ? __values.size() : __tree_pos[node];
+      } else {
+        size_t base = 0;
+        size_t n = __values.size();
+        while (n > 1) {
+          size_t half = n / 2;
+          base = __values[base + half - 1].first < k ? base + half : base;
+          n -= half;
+        }
+        return base + static_cast<size_t>(__values[base].first < k);
+      }
+    }
+    template <class Key> constexpr size_t __find(const Key &k) const noexcept {
+      size_t pos = __lower_bound(k);
+      if (pos != __values.size() && !(k < __values[pos].first)) {
+        return pos;
+      }
+      return __values.size();
+    }
+
+  public:
+    constexpr SortedKeyVector() : __values{}, __tree_keys{}, __tree_pos{} {}
+    constexpr SortedKeyVector(ContainerType container) : __values{std::move(container)} {
+      std::ranges::stable_sort(__values, std::ranges::less{}, &EntryType::first);
+      // Compact every run of equal keys into its last entry.
+      size_t write = 0;
+      for (size_t read = 0; read < __values.size(); read += 1) {
+        if (read + 1 < __values.size() && !(__values[read].first < __values[read + 1].first)) {
+          continue;
+        }
+        if (write != read) {
+          __values[write] = std::move(__values[read]);
+        }
+        write += 1;
+      }
+      __values.erase(__values.begin() + write, __values.end());
+      __rebuild_tree();
+    }
+    constexpr SortedKeyVector(std::initializer_list<EntryType> list) :
+      SortedKeyVector(ContainerType{list}) {}
+
+    /*
+      element getters.
+    */
+    template <IsOrderedWith<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<const ValueType>> get(Key &&k) const noexcept {
+      size_t pos = __find(k);
+      if (pos == __values.size()) {
+        return std::nullopt;
+      } else {
+        return std::cref(__values[pos].second);
+      }
+    }
+    template <IsOrderedWith<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<ValueType>> get(Key &&k) noexcept {
+      size_t pos = __find(k);
+      if (pos == __values.size()) {
+        return std::nullopt;
+      } else {
+        return std::ref(__values[pos].second);
+      }
+    }
+    template <IsOrderedWith<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<const ValueType>> operator[](
+      Key &&key
+    ) const noexcept {
+      return get(std::forward<Key>(key));
+    }
+    template <IsOrderedWith<KeyType> Key>
+    constexpr std::optional<std::reference_wrapper<ValueType>> operator[](Key &&key) noexcept {
+      return get(std::forward<Key>(key));
+    }
+
+    /*
+      element inserts. These are O(n) as the following entries have to be shifted.
+    */
+    template <IsOrderedWith<KeyType> Key, class... Args>
+    requires(std::is_constructible_v<KeyType, Key> && std::is_constructible_v<ValueType, Args...>)
+    constexpr ValueType &emplace(Key &&key, Args &&...args) {
+      size_t pos = __lower_bound(key);
+      if (pos != __values.size() && !(key < __values[pos].first)) {
+        __values[pos].second = ValueType{std::forward<Args>(args)...};
+        return __values[pos].second;
+      }
+      auto it = __values.emplace(
+        __values.begin() + pos,
+        KeyType{std::forward<Key>(key)},
+        ValueType{std::forward<Args>(args)...}
+      );
+      __rebuild_tree();
+      return it->second;
+    }
+    constexpr ValueType &insert(const KeyType &key, ValueType value) {
+      return emplace(key, std::move(value));
+    }
+    template <IsOrderedWith<KeyType> Key> constexpr std::optional<ValueType> remove(Key &&key) {
+      size_t pos = __find(key);
+      if (pos == __values.size()) {
+        return std::nullopt;
+      }
+      ValueType value = std::move(__values[pos].second);
+      __values.erase(__values.begin() + pos);
+      __rebuild_tree();
+      return std::optional{std::move(value)};
+    }
+
+    constexpr size_t size() const noexcept {
+      return __values.size();
+    }
+    constexpr bool empty() const noexcept {
+      return __values.empty();
+    }
+
+    constexpr auto begin() const noexcept {
+      return __values.begin();
+    }
+    constexpr auto end() const noexcept {
+      return __values.end();
+    }
+    // keys are const, the values can be written.
+    constexpr auto begin() noexcept {
+      return ConstKeyIterator{__values.begin()};
+    }
+    constexpr auto end() noexcept {
+      return ConstKeyIterator{__values.end()};
+    }
+
+    constexpr auto keys() const noexcept {
+      return std::ranges::transform_view{__values, &EntryType::first};
+    }
+  };
 }
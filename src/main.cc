@@ -2,5 +2,8 @@ export module jowi.generic;
 export import :variant;
 export import :key_vector;
 export import :fixed_string;
+export import :static_map;
 export import :is_formattable_error;
-export import :unique_handle;
\ No newline at end of file
+export import :diagnostics;
+export import :unique_handle;
+export import :atomic;
\ No newline at end of file
@@ -0,0 +1,185 @@
+module;
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+export module jowi.generic:static_map;
+import :fixed_string;
+
+namespace jowi::generic {
+  /*
+    StaticMap
+    immutable string keyed map whose perfect hash is computed at compile time by make_static_map.
+    Keys are split into buckets by their hash and every bucket gets a displacement that sends its
+    keys to distinct free slots (hash and displace), a lookup is one hash, one displacement, one
+    slot and one key comparison. Unused slots point at entry 0, a query that reaches one of them
+    can never be equal to that key, so there is no empty slot check.
+  */
+  export template <class ValueType, size_t Size, size_t KeyCapacity> requires(Size > 0)
+  class StaticMap {
+  public:
+    using KeyType = FixedString<KeyCapacity>;
+    using EntryType = std::pair<KeyType, ValueType>;
+    static constexpr size_t bucket_count = Size / 2 + 1;
+    static constexpr size_t table_size = std::bit_ceil(Size + Size / 4 + 1);
+
+  private:
+    static constexpr size_t __table_bits = std::countr_zero(table_size);
+
+    std::array<EntryType, Size> __entries;
+    std::array<uint32_t, bucket_count> __displacements;
+    std::array<uint32_t, table_size> __slots;
+
+    static constexpr uint64_t __hash(std::string_view key) noexcept {
+      // Readable is 0 so that string_view queries never load past their end, the result is equal
+      // to FixedString::hash.
+      return string_word_hash<0>(key.data(), key.length());
+    }
+    static constexpr size_t __bucket(uint64_t hash) noexcept {
+      return static_cast<size_t>(((hash >> 32) * bucket_count) >> 32);
+    }
+    static constexpr size_t __slot(uint64_t hash, uint32_t displacement) noexcept {
+      uint64_t h = (hash ^ (displacement * 0x9E37'79B9'7F4A'7C15)) * 0xBF58'476D'1CE4'E5B9;
+      return static_cast<size_t>(h >> (64 - __table_bits));
+    }
+
+  public:
+    /*
+      Computes the perfect hash, keys have to be distinct, a duplicate fails the constant
+      evaluation. See make_static_map.
+    */
+    consteval explicit StaticMap(const std::array<EntryType, Size> &entries) :
+      __entries{entries}, __displacements{}, __slots{} {
+      std::array<uint64_t, Size> hashes{};
+      std::array<size_t, Size> order{};
+      for (size_t i = 0; i < Size; i += 1) {
+        hashes[i] = __hash(__entries[i].first);
+        order[i] = i;
+        for (size_t j = 0; j < i; j += 1) {
+          if (__entries[j].first == __entries[i].first) {
+            throw std::invalid_argument{"StaticMap keys have to be distinct"};
+          }
+        }
+      }
+      std::array<size_t, bucket_count> bucket_sizes{};
+      for (size_t i = 0; i < Size; i += 1) {
+        bucket_sizes[__bucket(hashes[i])] += 1;
+      }
+      // largest buckets first, they are the hardest to place. Keys of a bucket end up adjacent.
+      auto placed_before = [&](size_t l, size_t r) {
+        size_t lb = __bucket(hashes[l]);
+        size_t rb = __bucket(hashes[r]);
+        return bucket_sizes[lb] > bucket_sizes[rb] ||
+          (bucket_sizes[lb] == bucket_sizes[rb] && lb < rb);
+      };
+      // std::stable_sort is not constexpr.
+      for (size_t i = 1; i < Size; i += 1) {
+        for (size_t j = i; j > 0 && placed_before(order[j], order[j - 1]); j -= 1) {
+          std::swap(order[j], order[j - 1]);
+        }
+      }
+      std::array<bool, table_size> taken{};
+      size_t i = 0;
+      while (i < Size) {
+        size_t bucket = __bucket(hashes[order[i]]);
+        size_t bucket_end = i + bucket_sizes[bucket];
+        uint32_t displacement = 0;
+        while (true) {
+          std::array<size_t, Size> placed{};
+          bool fits = true;
+          for (size_t k = i; k < bucket_end && fits; k += 1) {
+            size_t slot = __slot(hashes[order[k]], displacement);
+            fits = !taken[slot];
+            for (size_t p = i; p < k && fits; p += 1) {
+              fits = placed[p] != slot;
+            }
+            placed[k] = slot;
+          }
+          if (fits) {
+            for (size_t k = i; k < bucket_end; k += 1) {
+              taken[placed[k]] = true;
+              __slots[placed[k]] = static_cast<uint32_t>(order[k]);
+            }
+            __displacements[bucket] = displacement;
+            break;
+          }
+          if (displacement == (1u << 20)) {
+            throw std::logic_error{"StaticMap could not find a perfect hash"};
+          }
+          displacement += 1;
+        }
+        i = bucket_end;
+      }
+    }
+
+    constexpr const ValueType *find(std::string_view key) const noexcept {
+      if (key.length() > KeyCapacity) {
+        return nullptr;
+      }
+      uint64_t hash = __hash(key);
+      const auto &entry = __entries[__slots[__slot(hash, __displacements[__bucket(hash)])]];
+      if (entry.first != key) {
+        return nullptr;
+      }
+      return &entry.second;
+    }
+    constexpr std::optional<std::reference_wrapper<const ValueType>> get(
+      std::string_view key
+    ) const noexcept {
+      const ValueType *value = find(key);
+      if (value == nullptr) {
+        return std::nullopt;
+      }
+      return std::cref(*value);
+    }
+    constexpr std::optional<std::reference_wrapper<const ValueType>> operator[](
+      std::string_view key
+    ) const noexcept {
+      return get(key);
+    }
+    constexpr bool contains(std::string_view key) const noexcept {
+      return find(key) != nullptr;
+    }
+    // reverse lookup, a linear scan over the entries.
+    constexpr std::optional<std::string_view> key_of(const ValueType &value) const noexcept
+      requires(std::equality_comparable<ValueType>)
+    {
+      for (const auto &entry : __entries) {
+        if (entry.second == value) {
+          return std::string_view{entry.first};
+        }
+      }
+      return std::nullopt;
+    }
+
+    constexpr size_t size() const noexcept {
+      return Size;
+    }
+    // entries in the order they were given to make_static_map.
+    constexpr auto begin() const noexcept {
+      return __entries.begin();
+    }
+    constexpr auto end() const noexcept {
+      return __entries.end();
+    }
+  };
+
+  /*
+    Builds a StaticMap at compile time from a list of entries, the keys are FixedString literals of
+    at most KeyCapacity - 1 characters.
+      constexpr auto verbs = make_static_map<Verb, 8>({{"GET", Verb::get}, {"PUT", Verb::put}});
+  */
+  export template <class ValueType, size_t KeyCapacity, size_t Size>
+  consteval StaticMap<ValueType, Size, KeyCapacity> make_static_map(
+    const std::pair<FixedString<KeyCapacity>, ValueType> (&entries)[Size]
+  ) {
+    return StaticMap<ValueType, Size, KeyCapacity>{std::to_array(entries)};
+  }
+}
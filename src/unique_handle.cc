@@ -1,27 +1,132 @@
 module;
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 export module jowi.generic:unique_handle;
 
 namespace jowi::generic {
-  export template <class ValueType, std::invocable<ValueType> Destructor> struct UniqueHandle {
+  /*
+    Storage policies for UniqueHandle.
+    OptionalHandle keeps the value in a std::optional, any value is valid and get throws
+    std::bad_optional_access on an empty handle.
+  */
+  export struct OptionalHandle {
+    template <class ValueType> struct Storage {
+      std::optional<ValueType> value;
+
+      constexpr Storage() noexcept : value{std::nullopt} {}
+      constexpr explicit Storage(ValueType v) noexcept(
+        std::is_nothrow_move_constructible_v<ValueType>
+      ) : value{std::move(v)} {}
+
+      constexpr bool has_value() const noexcept {
+        return value.has_value();
+      }
+      constexpr const ValueType &get() const {
+        return value.value();
+      }
+      // throws std::bad_optional_access on an empty handle.
+      constexpr ValueType take() {
+        ValueType v = std::move(value).value();
+        value.reset();
+        return v;
+      }
+    };
+  };
+
+  /*
+    SentinelHandle marks an empty handle with an Invalid value (-1 for a file descriptor, nullptr
+    for a pointer), so the handle is as large as the value itself and get is a plain load. get on
+    an empty handle returns Invalid.
+  */
+  export template <auto Invalid> struct SentinelHandle {
+    template <class ValueType> requires(std::equality_comparable_with<ValueType, decltype(Invalid)>)
+    struct Storage {
+      ValueType value;
+
+      constexpr Storage() noexcept : value(Invalid) {}
+      constexpr explicit Storage(ValueType v) noexcept : value{std::move(v)} {}
+
+      constexpr bool has_value() const noexcept {
+        return value != Invalid;
+      }
+      constexpr const ValueType &get() const noexcept {
+        return value;
+      }
+      constexpr ValueType take() noexcept {
+        return std::exchange(value, ValueType(Invalid));
+      }
+    };
+  };
+
+  /*
+    UniqueHandle
+    Owns a value that has to be released through Destructor, the destructor is called once when the
+    handle is destroyed or overwritten while holding a value. A stateless Destructor takes no space.
+  */
+  export template <
+    class ValueType,
+    std::invocable<ValueType> Destructor,
+    class Policy = OptionalHandle>
+  struct UniqueHandle {
   private:
-    std::optional<ValueType> __v;
-    Destructor __d;
+    using StorageType = typename Policy::template Storage<ValueType>;
+    StorageType __v;
+    [[no_unique_address]] Destructor __d;
 
-  public:
-    UniqueHandle(ValueType v, Destructor d) : __v{v}, __d{d} {}
-    UniqueHandle(const UniqueHandle &) = delete;
-    UniqueHandle(UniqueHandle &&o) : __v{std::move(o.__v)}, __d{o.__d} {
-      if (o.__v) {
-        o.__v.reset();
+    static constexpr bool __nothrow_move = std::is_nothrow_move_constructible_v<ValueType> &&
+      std::is_nothrow_move_assignable_v<StorageType> &&
+      std::is_nothrow_move_constructible_v<Destructor>;
+
+    constexpr void __destroy() {
+      if (__v.has_value()) {
+        __d(__v.take());
+      }
+    }
+    // take cannot throw here, o holds a value.
+    static constexpr StorageType __take_storage(StorageType &o) noexcept(__nothrow_move) {
+      if (!o.has_value()) {
+        return StorageType{};
       }
+      return StorageType{o.take()};
     }
+
+  public:
+    constexpr UniqueHandle() requires(std::default_initializable<Destructor>) : __v{}, __d{} {}
+    constexpr UniqueHandle(ValueType v, Destructor d) : __v{std::move(v)}, __d{std::move(d)} {}
+    UniqueHandle(const UniqueHandle &) = delete;
+    constexpr UniqueHandle(UniqueHandle &&o) noexcept(__nothrow_move) :
+      __v{__take_storage(o.__v)}, __d{std::move(o.__d)} {}
     UniqueHandle &operator=(const UniqueHandle &o) = delete;
-    UniqueHandle &operator=(UniqueHandle &&o) {
-      __v = std::move(o.__v);
-      if (o.__v) {
-        o.__v.reset();
+    constexpr UniqueHandle &operator=(UniqueHandle &&o) noexcept(
+      __nothrow_move && std::is_nothrow_invocable_v<Destructor &, ValueType> &&
+      (!std::is_move_assignable_v<Destructor> || std::is_nothrow_move_assignable_v<Destructor>)
+    ) {
+      if (this != &o) {
+        __destroy();
+        // destructors that cannot be assigned (capturing lambdas) are rebuilt in place.
+        if constexpr (std::is_move_assignable_v<Destructor>) {
+          __d = std::move(o.__d);
+        } else {
+          std::destroy_at(std::addressof(__d));
+          std::construct_at(std::addressof(__d), std::move(o.__d));
+        }
+        __v = __take_storage(o.__v);
       }
       return *this;
     }
@@ -29,32 +134,406 @@ namespace jowi::generic {
     /*
      * Accessor Functions
      */
-    const ValueType &get() const {
-      return __v.value();
+    constexpr bool has_value() const noexcept {
+      return __v.has_value();
     }
-    ValueType get_or(ValueType fallback_value) const {
-      return __v.value_or(fallback_value);
+    constexpr const ValueType &get() const {
+      return __v.get();
     }
-    ValueType release() {
-      return std::move(__v).value();
+    constexpr ValueType get_or(ValueType fallback_value) const {
+      if (!__v.has_value()) {
+        return fallback_value;
+      }
+      return __v.get();
     }
-    ValueType release_or(ValueType fallback_value) const {
-      return std::move(__v).value_or(fallback_value);
+    // gives up the ownership, the destructor is not called on the returned value.
+    constexpr ValueType release() {
+      return __v.take();
     }
-
-    ~UniqueHandle() {
-      if (__v) {
-        __d(std::move(__v).value());
-        __v.reset();
+    constexpr ValueType release_or(ValueType fallback_value) {
+      if (!__v.has_value()) {
+        return fallback_value;
       }
+      return __v.take();
     }
 
-    static UniqueHandle manage_default(ValueType v) requires(std::constructible_from<Destructor>)
+    constexpr ~UniqueHandle() {
+      __destroy();
+    }
+
+    static constexpr UniqueHandle manage_default(ValueType v)
+      requires(std::constructible_from<Destructor>)
     {
       return UniqueHandle(std::move(v), Destructor{});
     }
-    static UniqueHandle manage(ValueType v, Destructor d) {
+    static constexpr UniqueHandle manage(ValueType v, Destructor d) {
       return UniqueHandle{std::move(v), std::move(d)};
     }
   };
-}
\ No newline at end of file
+  /*
+    destructor able to release a whole batch of values at once (one munmap, one submission). A
+    destructor that also accepts a single value, like a generic lambda, is called once per value.
+  */
+  export template <class Destructor, class ValueType>
+  concept IsBatchDestructor = std::invocable<Destructor &, std::span<ValueType>> &&
+    !std::invocable<Destructor &, ValueType>;
+
+  /*
+    HandleReaper
+    Deferred destruction queue. Values are handed over with defer or reap, which only append to a
+    buffer, and are destroyed later by flush, either at a point chosen by the caller or by a
+    background thread started with run_in_background. A batch destructor is called once per flush
+    with every pending value, any other destructor once per value. The values still pending are
+    destroyed when the reaper is. Exceptions thrown by the flushes of the background thread and of
+    the reaper's destructor are swallowed and counted, see failed_flushes.
+  */
+  export template <class ValueType, class Destructor>
+  requires(std::invocable<Destructor &, ValueType> || IsBatchDestructor<Destructor, ValueType>)
+  class HandleReaper {
+    Destructor __d;
+    size_t __batch_size;
+    std::mutex __mut;
+    std::condition_variable_any __cv;
+    std::vector<ValueType> __pending;
+    // guards __reaping, the two buffers are swapped so that their capacity is reused.
+    std::mutex __flush_mut;
+    std::vector<ValueType> __reaping;
+    std::atomic<uint64_t> __failed_flushes;
+    std::jthread __worker;
+
+    size_t __remaining() {
+      std::scoped_lock l{__flush_mut, __mut};
+      return __pending.size() + __reaping.size();
+    }
+    // flushes until nothing is left, or until a throwing flush stops making progress.
+    void __flush_all() noexcept {
+      while (true) {
+        size_t before = __remaining();
+        try {
+          flush();
+          return;
+        } catch (...) {
+          __failed_flushes.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (__remaining() >= before) {
+          return;
+        }
+      }
+    }
+
+  public:
+    HandleReaper(Destructor d = Destructor{}, size_t batch_size = 64) :
+      __d{std::move(d)}, __batch_size{batch_size}, __failed_flushes{0} {
+      __pending.reserve(batch_size);
+      __reaping.reserve(batch_size);
+    }
+    HandleReaper(const HandleReaper &) = delete;
+    HandleReaper &operator=(const HandleReaper &) = delete;
+
+    void defer(ValueType v) {
+      bool full = false;
+      {
+        std::lock_guard l{__mut};
+        __pending.emplace_back(std::move(v));
+        full = __pending.size() >= __batch_size;
+      }
+      if (full) {
+        __cv.notify_one();
+      }
+    }
+    // takes over the value of a handle using the same Destructor, which the reaper calls instead.
+    template <class Policy> void reap(UniqueHandle<ValueType, Destructor, Policy> &&handle) {
+      if (handle.has_value()) {
+        defer(handle.release());
+      }
+    }
+
+    /*
+      destroys every value deferred so far, returns how many were destroyed. When a destructor
+      throws, the values it was called on are dropped, the ones not reached yet are destroyed by the
+      next flush, and the exception is rethrown.
+    */
+    size_t flush() {
+      std::lock_guard flush_lock{__flush_mut};
+      {
+        std::lock_guard l{__mut};
+        if (__reaping.empty()) {
+          std::swap(__pending, __reaping);
+        } else {
+          __reaping.insert(
+            __reaping.end(),
+            std::make_move_iterator(__pending.begin()),
+            std::make_move_iterator(__pending.end())
+          );
+          __pending.clear();
+        }
+      }
+      size_t count = __reaping.size();
+      if constexpr (IsBatchDestructor<Destructor, ValueType>) {
+        if (count != 0) {
+          try {
+            std::invoke(__d, std::span<ValueType>{__reaping});
+          } catch (...) {
+            __reaping.clear();
+            throw;
+          }
+        }
+      } else {
+        size_t done = 0;
+        try {
+          for (; done < count; done += 1) {
+            std::invoke(__d, std::move(__reaping[done]));
+          }
+        } catch (...) {
+          // the values not reached yet stay in __reaping for the next flush.
+          __reaping.erase(
+            __reaping.begin(), __reaping.begin() + static_cast<std::ptrdiff_t>(done + 1)
+          );
+          throw;
+        }
+      }
+      __reaping.clear();
+      return count;
+    }
+    size_t pending() {
+      std::lock_guard l{__mut};
+      return __pending.size();
+    }
+    // flushes of the background thread or of the destructor that threw.
+    uint64_t failed_flushes() const noexcept {
+      return __failed_flushes.load(std::memory_order_relaxed);
+    }
+
+    /*
+      flushes on a background thread every interval, or earlier once batch_size values are
+      pending. The thread stops when the reaper is destroyed.
+    */
+    void run_in_background(std::chrono::milliseconds interval) {
+      if (__worker.joinable()) {
+        return;
+      }
+      __worker = std::jthread{[this, interval](std::stop_token stop) {
+        while (!stop.stop_requested()) {
+          {
+            std::unique_lock l{__mut};
+            __cv.wait_for(l, stop, interval, [&]() { return __pending.size() >= __batch_size; });
+          }
+          // the values a throwing flush did not reach are retried by the next one.
+          try {
+            flush();
+          } catch (...) {
+            __failed_flushes.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      }};
+    }
+
+    ~HandleReaper() {
+      if (__worker.joinable()) {
+        __worker.request_stop();
+        __worker.join();
+      }
+      __flush_all();
+    }
+  };
+  /*
+    HandlePool
+    Recycles values that are expensive to create (mapped buffers, sockets, compiled patterns).
+    acquire hands out a Lease, a UniqueHandle whose destructor gives the value back to the pool
+    instead of destroying it, release on a lease takes the value out of the pool for good. Every
+    thread caches up to cache_size idle values like the magazines of BlockPool, the rest are shared
+    and capped at capacity, a value given back to a full pool is destroyed. Shared values idle for
+    longer than max_idle are destroyed whenever a thread gives values back or on evict_idle.
+    Factory and Destructor are called from any thread, outside of the pool lock. Leases must not
+    outlive the pool.
+  */
+  export template <class ValueType, class Factory, class Destructor, class Policy = OptionalHandle>
+  requires(std::invocable<Factory &> && std::invocable<Destructor &, ValueType> &&
+           std::convertible_to<std::invoke_result_t<Factory &>, ValueType>)
+  class HandlePool {
+    using ClockType = std::chrono::steady_clock;
+    struct IdleValue {
+      ValueType value;
+      ClockType::time_point since;
+    };
+    struct State {
+      Factory factory;
+      Destructor destructor;
+      size_t capacity;
+      ClockType::duration max_idle;
+      std::atomic<bool> alive;
+      std::mutex mut;
+      // oldest first, acquire takes from the back.
+      std::vector<IdleValue> idle;
+
+      State(Factory f, Destructor d, size_t capacity, ClockType::duration max_idle) :
+        factory{std::move(f)}, destructor{std::move(d)}, capacity{capacity}, max_idle{max_idle},
+        alive{true} {}
+
+      // moves the values idle for too long into doomed, mut has to be held.
+      void collect_expired(ClockType::time_point now, std::vector<ValueType> &doomed) {
+        auto expired_end = std::ranges::find_if(idle, [&](const IdleValue &v) {
+          return now - v.since < max_idle;
+        });
+        for (auto it = idle.begin(); it != expired_end; ++it) {
+          doomed.emplace_back(std::move(it->value));
+        }
+        idle.erase(idle.begin(), expired_end);
+      }
+      void destroy(std::vector<ValueType> &doomed) {
+        for (auto &v : doomed) {
+          std::invoke(destructor, std::move(v));
+        }
+      }
+      // gives the last n values back to the shared list.
+      void give_back(std::vector<ValueType> &values, size_t n) {
+        std::vector<ValueType> doomed;
+        {
+          std::lock_guard l{mut};
+          auto now = ClockType::now();
+          collect_expired(now, doomed);
+          for (size_t i = values.size() - n; i < values.size(); i += 1) {
+            if (alive.load(std::memory_order_relaxed) && idle.size() < capacity) {
+              idle.emplace_back(std::move(values[i]), now);
+            } else {
+              doomed.emplace_back(std::move(values[i]));
+            }
+          }
+        }
+        values.erase(values.end() - n, values.end());
+        destroy(doomed);
+      }
+    };
+
+  public:
+    static constexpr size_t cache_size = 8;
+
+  private:
+    struct Cache {
+      std::shared_ptr<State> state;
+      std::vector<ValueType> values;
+
+      Cache(std::shared_ptr<State> s) : state{std::move(s)}, values{} {
+        values.reserve(cache_size);
+      }
+      Cache(Cache &&o) noexcept = default;
+      Cache &operator=(Cache &&o) noexcept {
+        flush();
+        state = std::move(o.state);
+        values = std::move(o.values);
+        return *this;
+      }
+      void flush() {
+        if (state) {
+          state->give_back(values, values.size());
+        }
+      }
+      ~Cache() {
+        flush();
+      }
+    };
+
+    std::shared_ptr<State> __state;
+
+    static std::vector<Cache> &__thread_caches() {
+      static thread_local std::vector<Cache> caches;
+      return caches;
+    }
+    Cache &__cache() {
+      auto &caches = __thread_caches();
+      for (auto &cache : caches) {
+        if (cache.state == __state) {
+          return cache;
+        }
+      }
+      // Caches of destroyed pools are dropped whenever a thread meets a new pool.
+      std::erase_if(caches, [](const Cache &c) {
+        return !c.state->alive.load(std::memory_order_relaxed);
+      });
+      return caches.emplace_back(__state);
+    }
+    void __refill(Cache &cache) {
+      std::lock_guard l{__state->mut};
+      while (cache.values.size() < cache_size / 2 && !__state->idle.empty()) {
+        cache.values.emplace_back(std::move(__state->idle.back().value));
+        __state->idle.pop_back();
+      }
+    }
+    void __recycle(ValueType v) {
+      Cache &cache = __cache();
+      if (cache.values.size() == cache_size) {
+        __state->give_back(cache.values, cache_size / 2);
+      }
+      cache.values.emplace_back(std::move(v));
+    }
+
+  public:
+    struct Recycler {
+      HandlePool *pool = nullptr;
+      void operator()(ValueType v) const {
+        pool->__recycle(std::move(v));
+      }
+    };
+    using Lease = UniqueHandle<ValueType, Recycler, Policy>;
+
+    explicit HandlePool(
+      Factory f = Factory{},
+      Destructor d = Destructor{},
+      size_t capacity = 64,
+      std::chrono::milliseconds max_idle = std::chrono::seconds{30}
+    ) :
+      __state{std::make_shared<State>(std::move(f), std::move(d), capacity, max_idle)} {}
+    HandlePool(const HandlePool &) = delete;
+    HandlePool &operator=(const HandlePool &) = delete;
+
+    /*
+      an idle value when there is one, a new value from Factory otherwise.
+    */
+    Lease acquire() {
+      Cache &cache = __cache();
+      if (cache.values.empty()) {
+        __refill(cache);
+      }
+      if (cache.values.empty()) {
+        return Lease::manage(std::invoke(__state->factory), Recycler{this});
+      }
+      ValueType v = std::move(cache.values.back());
+      cache.values.pop_back();
+      return Lease::manage(std::move(v), Recycler{this});
+    }
+
+    /*
+      destroys the shared values idle for longer than max_idle, returns how many were destroyed.
+      Values cached by threads are not affected.
+    */
+    size_t evict_idle() {
+      std::vector<ValueType> doomed;
+      {
+        std::lock_guard l{__state->mut};
+        __state->collect_expired(ClockType::now(), doomed);
+      }
+      __state->destroy(doomed);
+      return doomed.size();
+    }
+    // number of shared idle values.
+    size_t idle_count() {
+      std::lock_guard l{__state->mut};
+      return __state->idle.size();
+    }
+
+    ~HandlePool() {
+      auto &caches = __thread_caches();
+      std::erase_if(caches, [&](const Cache &c) { return c.state == __state; });
+      std::vector<ValueType> doomed;
+      {
+        std::lock_guard l{__state->mut};
+        __state->alive.store(false, std::memory_order_relaxed);
+        for (auto &v : __state->idle) {
+          doomed.emplace_back(std::move(v.value));
+        }
+        __state->idle.clear();
+      }
+      __state->destroy(doomed);
+    }
+  };
+}
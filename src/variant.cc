@@ -1,8 +1,19 @@
 module;
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 export module jowi.generic:variant;
 
 namespace jowi::generic {
@@ -13,6 +24,88 @@ namespace jowi::generic {
     using Overloads::operator()...;
   };
 
+  // Largest number of alternatives dispatched through a switch, larger variants dispatch through
+  // a table of function pointers.
+  export inline constexpr size_t variant_switch_limit = 32;
+
+  /*
+    Calls dispatch.template operator()<I>() for I = index through a switch. The switch compiles to a
+    jump table or a few compares that can be inlined, where std::visit may go through a table of
+    function pointers. An index of Size or more (valueless) throws std::bad_variant_access.
+    Like std::visit, every alternative has to produce the same result type.
+  */
+  template <size_t Size, class Dispatch>
+  constexpr decltype(auto) variant_switch(size_t index, Dispatch &&dispatch) {
+    using ResultType = decltype(dispatch.template operator()<0>());
+    static_assert(
+      []<size_t... Is>(std::index_sequence<Is...>) {
+        return (std::same_as<ResultType, decltype(dispatch.template operator()<Is>())> && ...);
+      }(std::make_index_sequence<Size>{}),
+      "the visitor has to return the same type for every alternative"
+    );
+    if constexpr (Size > variant_switch_limit) {
+      using DispatchType = std::remove_reference_t<Dispatch>;
+      constexpr auto table = []<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array{+[](DispatchType &d) -> ResultType {
+          return d.template operator()<Is>();
+        }...};
+      }(std::make_index_sequence<Size>{});
+      if (index >= Size) {
+        throw std::bad_variant_access{};
+      }
+      return table[index](dispatch);
+    } else {
+#define JOWI_GENERIC_VARIANT_CASE(I)                                                              \
+  case I:                                                                                         \
+    if constexpr (I < Size) {                                                                     \
+      return dispatch.template operator()<I>();                                                   \
+    } else {                                                                                      \
+      std::unreachable();                                                                         \
+    }
+#define JOWI_GENERIC_VARIANT_CASE_4(I)                                                            \
+  JOWI_GENERIC_VARIANT_CASE(I)                                                                    \
+  JOWI_GENERIC_VARIANT_CASE(I + 1)                                                                \
+  JOWI_GENERIC_VARIANT_CASE(I + 2)                                                                \
+  JOWI_GENERIC_VARIANT_CASE(I + 3)
+      switch (index) {
+        JOWI_GENERIC_VARIANT_CASE_4(0)
+        JOWI_GENERIC_VARIANT_CASE_4(4)
+        JOWI_GENERIC_VARIANT_CASE_4(8)
+        JOWI_GENERIC_VARIANT_CASE_4(12)
+        JOWI_GENERIC_VARIANT_CASE_4(16)
+        JOWI_GENERIC_VARIANT_CASE_4(20)
+        JOWI_GENERIC_VARIANT_CASE_4(24)
+        JOWI_GENERIC_VARIANT_CASE_4(28)
+        default:
+          throw std::bad_variant_access{};
+      }
+#undef JOWI_GENERIC_VARIANT_CASE_4
+#undef JOWI_GENERIC_VARIANT_CASE
+    }
+  }
+
+  // Alternative I of v without the index check, v has to hold alternative I.
+  template <size_t I, class VariantRef>
+  constexpr decltype(auto) variant_get_unchecked(VariantRef &&v) noexcept {
+    auto *value = std::get_if<I>(&v);
+    if constexpr (std::is_lvalue_reference_v<VariantRef>) {
+      return *value;
+    } else {
+      return std::move(*value);
+    }
+  }
+
+  // std::visit for a single std::variant, dispatched through variant_switch.
+  template <class Visitor, class VariantRef>
+  constexpr decltype(auto) variant_switch_visit(Visitor &&visitor, VariantRef &&v) {
+    constexpr size_t size = std::variant_size_v<std::remove_cvref_t<VariantRef>>;
+    return variant_switch<size>(v.index(), [&]<size_t I>() -> decltype(auto) {
+      return std::invoke(
+        std::forward<Visitor>(visitor), variant_get_unchecked<I>(std::forward<VariantRef>(v))
+      );
+    });
+  }
+
   /*
     Variant but with more member functions. This is so that the usage of the variant itself
     becomes more convenient for any API user. No additional features has been added except the fact
@@ -23,21 +116,99 @@ namespace jowi::generic {
     using VariantType = std::variant<Variants...>;
     VariantType __value;
 
+    template <typename... Others> friend class Variant;
+
+    // builds the value held by o straight into the returned variant, without a temporary.
+    template <class OtherVariant> static constexpr VariantType __convert(OtherVariant &&o) {
+      constexpr size_t size = std::variant_size_v<std::remove_cvref_t<decltype(o.__value)>>;
+      return variant_switch<size>(o.index(), [&]<size_t I>() -> VariantType {
+        auto &&value = variant_get_unchecked<I>(std::move(o.__value));
+        using ValueType = std::remove_cvref_t<decltype(value)>;
+        if constexpr (IsInTarget<ValueType, Variants...>) {
+          return VariantType{std::in_place_type<ValueType>, std::move(value)};
+        } else {
+          throw std::bad_variant_access{};
+        }
+      });
+    }
+
   public:
     template <typename... Args> requires(std::constructible_from<VariantType, Args...>)
     constexpr Variant(Args &&...args) : __value{std::forward<Args>(args)...} {}
 
+    /*
+      converting move from a Variant whose alternatives are a subset or a superset of these. The
+      held value is moved straight into place, a superset holding an alternative that is not one of
+      these throws std::bad_variant_access.
+    */
+    template <typename... Others>
+    requires(!std::same_as<Variant<Others...>, Variant> &&
+             ((IsInTarget<Others, Variants...> && ...) || (IsInTarget<Variants, Others...> && ...)))
+    constexpr Variant(Variant<Others...> &&o) noexcept(
+      (IsInTarget<Others, Variants...> && ...) &&
+      (std::is_nothrow_move_constructible_v<Others> && ...)
+    ) : __value{__convert(std::move(o))} {}
+
+    template <typename... Others>
+    requires(!std::same_as<Variant<Others...>, Variant> &&
+             ((IsInTarget<Others, Variants...> && ...) || (IsInTarget<Variants, Others...> && ...)))
+    constexpr Variant &operator=(Variant<Others...> &&o) {
+      std::move(o).visit([&]<class T>(T &&value) -> void {
+        if constexpr (IsInTarget<T, Variants...>) {
+          emplace_or_assign<T>(std::move(value));
+        } else {
+          throw std::bad_variant_access{};
+        }
+      });
+      return *this;
+    }
+
+    // assigns in place when the variant already holds a T, without going through std::visit.
     template <class T> requires(std::assignable_from<VariantType &, T>)
     constexpr Variant &operator=(T &&t) {
+      using ValueType = std::remove_cvref_t<T>;
+      if constexpr (IsInTarget<ValueType, Variants...> && std::is_assignable_v<ValueType &, T>) {
+        if (auto *value = std::get_if<ValueType>(&__value); value != nullptr) {
+          *value = std::forward<T>(t);
+          return *this;
+        }
+      }
       __value = std::forward<T>(t);
       return *this;
     }
     template <IsInTarget<Variants...> T, class... Args>
-    constexpr Variant &emplace(Args &&...args) noexcept {
+    requires(std::constructible_from<T, Args...>)
+    constexpr Variant &emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>
+    ) {
       __value.template emplace<T>(std::forward<Args>(args)...);
       return *this;
     }
 
+    /*
+      assigns to the held value when it already is a T, so its storage (a string buffer for
+      instance) is reused, emplaces a T otherwise.
+    */
+    template <class T> requires(IsInTarget<std::remove_cvref_t<T>, Variants...>)
+    constexpr Variant &assign(T &&value) {
+      return emplace_or_assign<std::remove_cvref_t<T>>(std::forward<T>(value));
+    }
+
+    /*
+      emplace that assigns instead when the variant holds a T and T is assignable from args.
+    */
+    template <IsInTarget<Variants...> T, class... Args>
+    requires(std::constructible_from<T, Args...>)
+    constexpr Variant &emplace_or_assign(Args &&...args) {
+      if constexpr (sizeof...(Args) == 1 && (std::is_assignable_v<T &, Args> && ...)) {
+        if (auto *value = std::get_if<T>(&__value); value != nullptr) {
+          *value = (std::forward<Args>(args), ...);
+          return *this;
+        }
+      }
+      return emplace<T>(std::forward<Args>(args)...);
+    }
+
     constexpr int index() const noexcept {
       return __value.index();
     }
@@ -54,35 +225,335 @@ namespace jowi::generic {
     */
     template <IsInTarget<Variants...> TestType>
     constexpr std::optional<std::reference_wrapper<TestType>> as() noexcept {
-      using OptionalType = std::optional<std::reference_wrapper<TestType>>;
-      return std::visit(
-        [](auto &v) -> OptionalType {
-          using CurrentType = std::decay_t<decltype(v)>;
-          if constexpr (std::same_as<CurrentType, TestType>) {
-            return OptionalType{std::ref(v)};
-          } else {
-            return OptionalType{};
-          }
-        },
-        __value
-      );
+      if (auto *value = std::get_if<TestType>(&__value); value != nullptr) {
+        return std::ref(*value);
+      }
+      return std::nullopt;
     }
 
     template <IsInTarget<Variants...> TestType>
     constexpr std::optional<std::reference_wrapper<const TestType>> as() const noexcept {
-      using OptionalType = std::optional<std::reference_wrapper<const TestType>>;
-      return std::visit(
-        [](auto &v) -> OptionalType {
-          using CurrentType = std::decay_t<decltype(v)>;
-          if constexpr (std::same_as<CurrentType, TestType>) {
-            return OptionalType{std::cref(v)};
-          } else {
-            return OptionalType{};
-          }
-        },
-        __value
+      if (const auto *value = std::get_if<TestType>(&__value); value != nullptr) {
+        return std::cref(*value);
+      }
+      return std::nullopt;
+    }
+
+    /**
+      visitor functions
+    */
+    template <class... Functions>
+    requires(std::invocable<VariantVisitorOverload<Functions...>, Variants &> && ...)
+    constexpr auto visit(Functions &&...f) & {
+      return variant_switch_visit(
+        VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...}, __value
       );
     }
+    template <class... Functions>
+    requires(std::invocable<VariantVisitorOverload<Functions...>, const Variants &> && ...)
+    constexpr auto visit(Functions &&...f) const & {
+      return variant_switch_visit(
+        VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...}, __value
+      );
+    }
+    template <class... Functions>
+    requires(std::invocable<VariantVisitorOverload<Functions...>, Variants &&> && ...)
+    constexpr auto visit(Functions &&...f) && {
+      return variant_switch_visit(
+        VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...}, std::move(__value)
+      );
+    }
+  };
+
+  // position of T in Alternatives, sizeof...(Alternatives) when T is not one of them.
+  template <class T, class... Alternatives> consteval size_t variant_index_of() {
+    constexpr bool matches[] = {std::same_as<T, Alternatives>...};
+    for (size_t i = 0; i < sizeof...(Alternatives); i += 1) {
+      if (matches[i]) {
+        return i;
+      }
+    }
+    return sizeof...(Alternatives);
+  }
+
+  /*
+    imaginary function F(Ti) of the converting constructor of std::variant, only viable when
+    Ti x[] = {std::forward<T>(t)} is, so a narrowing conversion (const char * to bool, double to
+    int) never selects Ti.
+  */
+  template <size_t I, class Ti> struct VariantAlternativeOverload {
+    template <class T> requires requires { std::type_identity_t<Ti[1]>{std::declval<T>()}; }
+    std::integral_constant<size_t, I> operator()(Ti, T &&) const;
+  };
+  template <class Indices, class... Alternatives> struct VariantAlternativeOverloadSet;
+  template <size_t... Is, class... Alternatives>
+  struct VariantAlternativeOverloadSet<std::index_sequence<Is...>, Alternatives...> :
+    VariantAlternativeOverload<Is, Alternatives>... {
+    using VariantAlternativeOverload<Is, Alternatives>::operator()...;
+  };
+
+  /*
+    alternative the converting constructors pick for a T, chosen by overload resolution over
+    F(Ti) for every alternative exactly like std::variant. sizeof...(Alternatives) when no F is
+    viable or the call is ambiguous.
+  */
+  template <class T, class... Alternatives> consteval size_t variant_alternative_for() {
+    using OverloadSet =
+      VariantAlternativeOverloadSet<std::index_sequence_for<Alternatives...>, Alternatives...>;
+    if constexpr (requires { OverloadSet{}(std::declval<T>(), std::declval<T>()); }) {
+      return decltype(OverloadSet{}(std::declval<T>(), std::declval<T>()))::value;
+    } else {
+      return sizeof...(Alternatives);
+    }
+  }
+
+  template <size_t Count>
+  using CompactIndexType = std::conditional_t<
+    Count <= 0xFF,
+    uint8_t,
+    std::conditional_t<Count <= 0xFFFF, uint16_t, uint32_t>>;
+
+  template <class... Alternatives> union CompactUnion {};
+  template <class Head, class... Tail> union CompactUnion<Head, Tail...> {
+    Head head;
+    CompactUnion<Tail...> tail;
+
+    constexpr CompactUnion() noexcept {}
+    constexpr ~CompactUnion() requires(std::is_trivially_destructible_v<Head> &&
+                                       (std::is_trivially_destructible_v<Tail> && ...))
+    = default;
+    constexpr ~CompactUnion() {}
+  };
+
+  template <size_t I, class Union> constexpr auto &compact_union_get(Union &u) noexcept {
+    if constexpr (I == 0) {
+      return u.head;
+    } else {
+      return compact_union_get<I - 1>(u.tail);
+    }
+  }
+  template <size_t I, class Union, class... Args>
+  constexpr void compact_union_construct(Union &u, Args &&...args) {
+    if constexpr (I == 0) {
+      std::construct_at(std::addressof(u.head), std::forward<Args>(args)...);
+    } else {
+      // activates the nested union first, needed during constant evaluation only.
+      std::construct_at(std::addressof(u.tail));
+      compact_union_construct<I - 1>(u.tail, std::forward<Args>(args)...);
+    }
+  }
+
+  template <class T>
+  concept IsTaggablePointer = std::is_pointer_v<T> && std::is_object_v<std::remove_pointer_t<T>> &&
+    requires { sizeof(std::remove_pointer_t<T>); };
+
+  template <class T> consteval size_t compact_pointer_alignment() {
+    if constexpr (std::same_as<T, std::monostate>) {
+      return alignof(std::max_align_t);
+    } else {
+      return alignof(std::remove_pointer_t<T>);
+    }
+  }
+
+  template <class... Alternatives>
+  concept IsCompactStorable =
+    sizeof...(Alternatives) > 0 && (std::is_nothrow_move_constructible_v<Alternatives> && ...);
+
+  // the fold expressions are wrapped in concepts so that the trivial special members subsume the
+  // constraints of the non trivial ones.
+  template <class... Alternatives>
+  concept IsCopyConstructibleAll = (std::copy_constructible<Alternatives> && ...);
+  template <class... Alternatives>
+  concept IsTriviallyCopyConstructibleAll = IsCopyConstructibleAll<Alternatives...> &&
+    (std::is_trivially_copy_constructible_v<Alternatives> && ...);
+  template <class... Alternatives>
+  concept IsTriviallyCopyAssignableAll = IsTriviallyCopyConstructibleAll<Alternatives...> &&
+    ((std::is_trivially_copy_assignable_v<Alternatives> &&
+      std::is_trivially_destructible_v<Alternatives>) &&
+     ...);
+
+  // every alternative is a pointer or std::monostate and the pointees leave enough low bits free
+  // for the index.
+  template <class... Alternatives>
+  concept IsPointerPackable =
+    ((IsTaggablePointer<Alternatives> || std::same_as<Alternatives, std::monostate>) && ...) &&
+    (std::bit_width(sizeof...(Alternatives) - 1) <=
+     std::countr_zero(std::min({compact_pointer_alignment<Alternatives>()...})));
+
+  /*
+    CompactVariant
+    Variant with a smaller footprint for alternatives stored in bulk. The alternatives live in a
+    union followed by the smallest index type that can count them, so the index takes a single
+    byte for up to 255 alternatives. The index follows the union, it never lives in the tail
+    padding of the largest alternative, so the variant is the size of that alternative plus one
+    alignment step at most. is, as and visit behave like in Variant.
+    Every alternative has to be nothrow move constructible, emplace builds the new value first when
+    its constructor may throw, so the variant is never valueless.
+  */
+  export template <class... Variants> requires(IsCompactStorable<Variants...>)
+  class CompactVariant {
+    using IndexType = CompactIndexType<sizeof...(Variants)>;
+    static constexpr size_t __count = sizeof...(Variants);
+
+    CompactUnion<Variants...> __storage;
+    IndexType __index;
+
+    template <size_t I>
+    using AlternativeType = std::variant_alternative_t<I, std::variant<Variants...>>;
+
+    template <size_t I, class Self> static constexpr decltype(auto) __get(Self &&self) noexcept {
+      auto &value = compact_union_get<I>(self.__storage);
+      if constexpr (std::is_lvalue_reference_v<Self>) {
+        return value;
+      } else {
+        return std::move(value);
+      }
+    }
+    template <class Self, class Visitor>
+    static constexpr decltype(auto) __visit(Self &&self, Visitor &&visitor) {
+      return variant_switch<__count>(self.__index, [&]<size_t I>() -> decltype(auto) {
+        return std::invoke(std::forward<Visitor>(visitor), __get<I>(std::forward<Self>(self)));
+      });
+    }
+
+    constexpr void __destroy() noexcept {
+      variant_switch<__count>(__index, [&]<size_t I>() {
+        std::destroy_at(std::addressof(compact_union_get<I>(__storage)));
+      });
+    }
+    template <size_t I, class... Args> constexpr void __construct(Args &&...args) {
+      compact_union_construct<I>(__storage, std::forward<Args>(args)...);
+      __index = static_cast<IndexType>(I);
+    }
+    template <class Other> constexpr void __construct_from(Other &&o) {
+      variant_switch<__count>(o.__index, [&]<size_t I>() {
+        __construct<I>(__get<I>(std::forward<Other>(o)));
+      });
+    }
+    template <size_t I, class... Args> constexpr void __replace(Args &&...args) {
+      if constexpr (std::is_nothrow_constructible_v<AlternativeType<I>, Args...>) {
+        __destroy();
+        __construct<I>(std::forward<Args>(args)...);
+      } else {
+        AlternativeType<I> value(std::forward<Args>(args)...);
+        __destroy();
+        __construct<I>(std::move(value));
+      }
+    }
+
+  public:
+    constexpr CompactVariant() noexcept(std::is_nothrow_default_constructible_v<AlternativeType<0>>)
+    requires(std::default_initializable<AlternativeType<0>>)
+    {
+      __construct<0>();
+    }
+    template <class T, size_t I = variant_alternative_for<T, Variants...>()>
+    requires(I < sizeof...(Variants) && !std::same_as<std::remove_cvref_t<T>, CompactVariant>)
+    constexpr CompactVariant(T &&value) noexcept(
+      std::is_nothrow_constructible_v<AlternativeType<I>, T>
+    ) {
+      __construct<I>(std::forward<T>(value));
+    }
+    template <IsInTarget<Variants...> T, class... Args>
+    requires(std::constructible_from<T, Args...>)
+    constexpr explicit CompactVariant(std::in_place_type_t<T>, Args &&...args) {
+      __construct<variant_index_of<T, Variants...>()>(std::forward<Args>(args)...);
+    }
+
+    constexpr CompactVariant(const CompactVariant &)
+    requires(IsTriviallyCopyConstructibleAll<Variants...>)
+    = default;
+    constexpr CompactVariant(const CompactVariant &o) requires(IsCopyConstructibleAll<Variants...>)
+    {
+      __construct_from(o);
+    }
+    constexpr CompactVariant(CompactVariant &&)
+    requires(std::is_trivially_move_constructible_v<Variants> && ...)
+    = default;
+    constexpr CompactVariant(CompactVariant &&o) noexcept {
+      __construct_from(std::move(o));
+    }
+
+    constexpr CompactVariant &operator=(const CompactVariant &)
+    requires(IsTriviallyCopyAssignableAll<Variants...>)
+    = default;
+    constexpr CompactVariant &operator=(const CompactVariant &o)
+    requires(IsCopyConstructibleAll<Variants...>)
+    {
+      if (this != &o) {
+        variant_switch<__count>(o.__index, [&]<size_t I>() { __replace<I>(__get<I>(o)); });
+      }
+      return *this;
+    }
+    constexpr CompactVariant &operator=(CompactVariant &&)
+    requires((std::is_trivially_move_constructible_v<Variants> &&
+              std::is_trivially_move_assignable_v<Variants> &&
+              std::is_trivially_destructible_v<Variants>) &&
+             ...)
+    = default;
+    constexpr CompactVariant &operator=(CompactVariant &&o) noexcept {
+      if (this != &o) {
+        __destroy();
+        __construct_from(std::move(o));
+      }
+      return *this;
+    }
+    template <class T, size_t I = variant_alternative_for<T, Variants...>()>
+    requires(I < sizeof...(Variants) && !std::same_as<std::remove_cvref_t<T>, CompactVariant>)
+    constexpr CompactVariant &operator=(T &&value) {
+      if constexpr (std::is_assignable_v<AlternativeType<I> &, T>) {
+        if (__index == I) {
+          compact_union_get<I>(__storage) = std::forward<T>(value);
+          return *this;
+        }
+      }
+      __replace<I>(std::forward<T>(value));
+      return *this;
+    }
+    template <IsInTarget<Variants...> T, class... Args>
+    requires(std::constructible_from<T, Args...>)
+    constexpr CompactVariant &emplace(Args &&...args) {
+      __replace<variant_index_of<T, Variants...>()>(std::forward<Args>(args)...);
+      return *this;
+    }
+
+    constexpr ~CompactVariant()
+    requires(std::is_trivially_destructible_v<Variants> && ...)
+    = default;
+    constexpr ~CompactVariant() {
+      __destroy();
+    }
+
+    constexpr int index() const noexcept {
+      return __index;
+    }
+
+    /**
+      variant checking functions.
+    */
+    template <IsInTarget<Variants...> TestType> constexpr bool is() const noexcept {
+      return __index == variant_index_of<TestType, Variants...>();
+    }
+
+    /**
+      casting functions
+    */
+    template <IsInTarget<Variants...> TestType>
+    constexpr std::optional<std::reference_wrapper<TestType>> as() noexcept {
+      constexpr size_t I = variant_index_of<TestType, Variants...>();
+      if (__index != I) {
+        return std::nullopt;
+      }
+      return std::ref(compact_union_get<I>(__storage));
+    }
+    template <IsInTarget<Variants...> TestType>
+    constexpr std::optional<std::reference_wrapper<const TestType>> as() const noexcept {
+      constexpr size_t I = variant_index_of<TestType, Variants...>();
+      if (__index != I) {
+        return std::nullopt;
+      }
+      return std::cref(compact_union_get<I>(__storage));
+    }
 
     /**
       visitor functions
@@ -90,17 +561,326 @@ namespace jowi::generic {
     template <class... Functions>
     requires(std::invocable<VariantVisitorOverload<Functions...>, Variants &> && ...)
     constexpr auto visit(Functions &&...f) & {
-      return std::visit(VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...}, __value);
+      return __visit(*this, VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...});
     }
     template <class... Functions>
     requires(std::invocable<VariantVisitorOverload<Functions...>, const Variants &> && ...)
     constexpr auto visit(Functions &&...f) const & {
-      return std::visit(VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...}, __value);
+      return __visit(*this, VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...});
     }
     template <class... Functions>
     requires(std::invocable<VariantVisitorOverload<Functions...>, Variants &&> && ...)
     constexpr auto visit(Functions &&...f) && {
-      return std::visit(VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...}, std::move(__value));
+      return __visit(
+        std::move(*this), VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...}
+      );
+    }
+  };
+
+  /*
+    PointerVariant
+    Variant of pointers (and std::monostate), packed into a single word. The index is kept in
+    the low bits that the alignment of every pointee leaves zero, so PointerVariant<A *, B *> is the
+    size of one pointer. The alternatives do not exist as objects, as returns a copy of the pointer
+    and visit passes it by value.
+  */
+  export template <class... Variants> requires(IsPointerPackable<Variants...>)
+  class PointerVariant {
+    static constexpr size_t __count = sizeof...(Variants);
+    static constexpr uintptr_t __index_mask = std::bit_ceil(__count) - 1;
+
+    uintptr_t __word;
+
+    template <size_t I>
+    using AlternativeType = std::variant_alternative_t<I, std::variant<Variants...>>;
+
+    template <size_t I> constexpr AlternativeType<I> __get() const noexcept {
+      if constexpr (std::same_as<AlternativeType<I>, std::monostate>) {
+        return std::monostate{};
+      } else {
+        return reinterpret_cast<AlternativeType<I>>(__word & ~__index_mask);
+      }
+    }
+    template <size_t I> static constexpr uintptr_t __pack(AlternativeType<I> value) noexcept {
+      if constexpr (std::same_as<AlternativeType<I>, std::monostate>) {
+        return I;
+      } else {
+        return reinterpret_cast<uintptr_t>(value) | I;
+      }
+    }
+    template <class Visitor> constexpr decltype(auto) __visit(Visitor &&visitor) const {
+      return variant_switch<__count>(index(), [&]<size_t I>() -> decltype(auto) {
+        return std::invoke(std::forward<Visitor>(visitor), __get<I>());
+      });
+    }
+
+  public:
+    constexpr PointerVariant() noexcept : __word{__pack<0>(AlternativeType<0>{})} {}
+    template <class T, size_t I = variant_alternative_for<T, Variants...>()>
+    requires(I < sizeof...(Variants) && !std::same_as<std::remove_cvref_t<T>, PointerVariant>)
+    constexpr PointerVariant(T &&value) noexcept : __word{__pack<I>(std::forward<T>(value))} {}
+    template <IsInTarget<Variants...> T, class... Args>
+    requires(std::constructible_from<T, Args...>)
+    constexpr explicit PointerVariant(std::in_place_type_t<T>, Args &&...args) noexcept :
+      __word{__pack<variant_index_of<T, Variants...>()>(T(std::forward<Args>(args)...))} {}
+
+    template <class T, size_t I = variant_alternative_for<T, Variants...>()>
+    requires(I < sizeof...(Variants) && !std::same_as<std::remove_cvref_t<T>, PointerVariant>)
+    constexpr PointerVariant &operator=(T &&value) noexcept {
+      __word = __pack<I>(std::forward<T>(value));
+      return *this;
+    }
+    template <IsInTarget<Variants...> T, class... Args>
+    requires(std::constructible_from<T, Args...>)
+    constexpr PointerVariant &emplace(Args &&...args) noexcept {
+      __word = __pack<variant_index_of<T, Variants...>()>(T(std::forward<Args>(args)...));
+      return *this;
+    }
+
+    constexpr int index() const noexcept {
+      return static_cast<int>(__word & __index_mask);
+    }
+
+    /**
+      variant checking functions.
+    */
+    template <IsInTarget<Variants...> TestType> constexpr bool is() const noexcept {
+      return index() == static_cast<int>(variant_index_of<TestType, Variants...>());
+    }
+
+    /**
+      casting functions
+    */
+    template <IsInTarget<Variants...> TestType>
+    constexpr std::optional<TestType> as() const noexcept {
+      constexpr size_t I = variant_index_of<TestType, Variants...>();
+      if (!is<TestType>()) {
+        return std::nullopt;
+      }
+      return __get<I>();
+    }
+
+    /**
+      visitor functions
+    */
+    template <class... Functions>
+    requires(std::invocable<VariantVisitorOverload<Functions...>, Variants> && ...)
+    constexpr auto visit(Functions &&...f) const {
+      return __visit(VariantVisitorOverload<Functions...>{std::forward<Functions>(f)...});
+    }
+  };
+
+  /*
+    VariantRef
+    Non owning view of a single element of a VariantVector with the is, as and visit functions of
+    Variant. The alternatives are const qualified in a view of a const container, is and as still
+    take the unqualified type.
+  */
+  export template <class... Variants> class VariantRef {
+    std::variant<Variants *...> __ptr;
+
+    template <class T>
+    static constexpr size_t __index_of = variant_index_of<T, std::remove_const_t<Variants>...>();
+    template <size_t I>
+    using AlternativeType = std::variant_alternative_t<I, std::variant<Variants...>>;
+
+  public:
+    template <size_t I>
+    constexpr VariantRef(std::in_place_index_t<I> i, AlternativeType<I> *ptr) noexcept :
+      __ptr{i, ptr} {}
+
+    constexpr int index() const noexcept {
+      return __ptr.index();
+    }
+
+    /**
+      variant checking functions.
+    */
+    template <IsInTarget<std::remove_const_t<Variants>...> TestType>
+    constexpr bool is() const noexcept {
+      return __ptr.index() == __index_of<TestType>;
+    }
+
+    /**
+      casting functions
+    */
+    template <IsInTarget<std::remove_const_t<Variants>...> TestType>
+    constexpr std::optional<std::reference_wrapper<AlternativeType<__index_of<TestType>>>> as(
+    ) const noexcept {
+      if (auto *ptr = std::get_if<__index_of<TestType>>(&__ptr); ptr != nullptr) {
+        return std::ref(**ptr);
+      }
+      return std::nullopt;
+    }
+
+    /**
+      visitor functions
+    */
+    template <class... Functions>
+    requires(std::invocable<VariantVisitorOverload<Functions...>, Variants &> && ...)
+    constexpr auto visit(Functions &&...f) const {
+      VariantVisitorOverload<Functions...> visitor{std::forward<Functions>(f)...};
+      return variant_switch<sizeof...(Variants)>(__ptr.index(), [&]<size_t I>() -> decltype(auto) {
+        return std::invoke(visitor, **std::get_if<I>(&__ptr));
+      });
+    }
+  };
+
+  /*
+    VariantVector
+    Sequence of Variant<Variants...> stored as a struct of arrays: every alternative has its own
+    contiguous column and the insertion order is kept as one small index per element.
+    visit_all walks the columns one after the other, so the visitor is resolved once per
+    alternative instead of once per element and every loop runs over values of a single type. The
+    ordered iteration yields VariantRef views in insertion order.
+  */
+  export template <class... Variants> requires(sizeof...(Variants) > 0)
+  class VariantVector {
+    using IndexType = CompactIndexType<sizeof...(Variants)>;
+    std::tuple<std::vector<Variants>...> __columns;
+    std::vector<IndexType> __order;
+
+    template <class T> static constexpr size_t __index_of = variant_index_of<T, Variants...>();
+    template <size_t I>
+    using AlternativeType = std::variant_alternative_t<I, std::variant<Variants...>>;
+
+    template <class Container, class Reference> struct Iterator {
+      using value_type = Reference;
+      using reference = Reference;
+      using difference_type = std::ptrdiff_t;
+
+      Container *container;
+      size_t position;
+      // position of the next element of every alternative in its column.
+      std::array<size_t, sizeof...(Variants)> offsets;
+
+      constexpr reference operator*() const {
+        return variant_switch<sizeof...(Variants)>(container->__order[position], [&]<size_t I>() {
+          return reference{
+            std::in_place_index<I>, std::get<I>(container->__columns).data() + offsets[I]
+          };
+        });
+      }
+      constexpr Iterator &operator++() noexcept {
+        offsets[container->__order[position]] += 1;
+        position += 1;
+        return *this;
+      }
+      constexpr Iterator operator++(int) noexcept {
+        Iterator it = *this;
+        ++(*this);
+        return it;
+      }
+      friend constexpr bool operator==(const Iterator &l, const Iterator &r) noexcept {
+        return l.position == r.position;
+      }
+    };
+
+    using MutableIterator = Iterator<VariantVector, VariantRef<Variants...>>;
+    using ConstIterator = Iterator<const VariantVector, VariantRef<const Variants...>>;
+
+    template <class Visitor, class Column>
+    static constexpr void __visit_column(Visitor &visitor, Column &column) {
+      for (auto &value : column) {
+        std::invoke(visitor, value);
+      }
+    }
+
+  public:
+    constexpr VariantVector() : __columns{}, __order{} {}
+
+    /*
+      element insertion, the value is appended to the column of its alternative.
+    */
+    template <IsInTarget<Variants...> T, class... Args>
+    requires(std::constructible_from<T, Args...>)
+    constexpr T &emplace_back(Args &&...args) {
+      auto &column = std::get<__index_of<T>>(__columns);
+      column.emplace_back(std::forward<Args>(args)...);
+      try {
+        __order.push_back(static_cast<IndexType>(__index_of<T>));
+      } catch (...) {
+        column.pop_back();
+        throw;
+      }
+      return column.back();
+    }
+    template <class T, size_t I = variant_alternative_for<T, Variants...>()>
+    requires(I < sizeof...(Variants) && !std::same_as<std::remove_cvref_t<T>, Variant<Variants...>>)
+    constexpr void push_back(T &&value) {
+      emplace_back<AlternativeType<I>>(std::forward<T>(value));
+    }
+    constexpr void push_back(const Variant<Variants...> &value) {
+      value.visit([&]<class T>(const T &v) -> void { emplace_back<T>(v); });
+    }
+    constexpr void push_back(Variant<Variants...> &&value) {
+      std::move(value).visit([&]<class T>(T &&v) -> void { emplace_back<T>(std::move(v)); });
+    }
+    constexpr void reserve(size_t size) {
+      __order.reserve(size);
+    }
+    constexpr void clear() noexcept {
+      std::apply([](auto &...columns) { (columns.clear(), ...); }, __columns);
+      __order.clear();
+    }
+
+    /*
+      size getters.
+    */
+    constexpr size_t size() const noexcept {
+      return __order.size();
+    }
+    constexpr bool empty() const noexcept {
+      return __order.empty();
+    }
+    template <IsInTarget<Variants...> T> constexpr size_t count() const noexcept {
+      return std::get<__index_of<T>>(__columns).size();
+    }
+
+    /*
+      every value of alternative T, in insertion order.
+    */
+    template <IsInTarget<Variants...> T> constexpr std::span<T> column() noexcept {
+      return std::get<__index_of<T>>(__columns);
+    }
+    template <IsInTarget<Variants...> T> constexpr std::span<const T> column() const noexcept {
+      return std::get<__index_of<T>>(__columns);
+    }
+
+    /*
+      calls the visitor on every element, alternative by alternative in the order of Variants. The
+      relative order of the values of one alternative is kept, the order across alternatives is
+      not, iterate the container when it matters.
+    */
+    template <class... Functions>
+    requires(std::invocable<VariantVisitorOverload<Functions...>, Variants &> && ...)
+    constexpr void visit_all(Functions &&...f) {
+      VariantVisitorOverload<Functions...> visitor{std::forward<Functions>(f)...};
+      std::apply([&](auto &...columns) { (__visit_column(visitor, columns), ...); }, __columns);
+    }
+    template <class... Functions>
+    requires(std::invocable<VariantVisitorOverload<Functions...>, const Variants &> && ...)
+    constexpr void visit_all(Functions &&...f) const {
+      VariantVisitorOverload<Functions...> visitor{std::forward<Functions>(f)...};
+      std::apply(
+        [&](const auto &...columns) { (__visit_column(visitor, columns), ...); }, __columns
+      );
+    }
+
+    /*
+      iterators, in insertion order.
+    */
+    constexpr MutableIterator begin() noexcept {
+      return MutableIterator{this, 0, {}};
+    }
+    constexpr MutableIterator end() noexcept {
+      return MutableIterator{this, __order.size(), {}};
+    }
+    constexpr ConstIterator begin() const noexcept {
+      return ConstIterator{this, 0, {}};
+    }
+    constexpr ConstIterator end() const noexcept {
+      return ConstIterator{this, __order.size(), {}};
     }
   };
 }
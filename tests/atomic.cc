@@ -0,0 +1,517 @@
+import jowi.test_lib;
+import jowi.generic;
+#include <jowi/test_lib.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace test_lib = jowi::test_lib;
+namespace generic = jowi::generic;
+
+JOWI_ADD_TEST(tagged_ptr_round_trip) {
+  int value = 0;
+  auto ptr = generic::Uint16TaggedPtr::from_pair(&value, 0xBEEF);
+  test_lib::assert_equal(ptr.raw_ptr(), static_cast<void *>(&value));
+  test_lib::assert_equal(ptr.tag(), uint16_t{0xBEEF});
+}
+
+JOWI_ADD_TEST(low_bits_tagged_ptr_round_trip) {
+  using Ptr = generic::TaggedPtr<uint32_t, generic::LowBitsTag<16>>;
+  alignas(16) int value = 0;
+  test_lib::assert_true(Ptr::can_hold(&value));
+  auto ptr = Ptr::from_pair(&value, 0x1B);
+  test_lib::assert_equal(ptr.raw_ptr(), static_cast<void *>(&value));
+  test_lib::assert_equal(ptr.tag(), uint32_t{0xB});
+}
+
+JOWI_ADD_TEST(double_word_tagged_ptr_compare_exchange) {
+  int value = 0;
+  auto ptr = generic::DoubleWordTaggedPtr::from_pair(&value, 0xDEAD'BEEF'CAFE);
+  test_lib::assert_equal(ptr.raw_ptr(), static_cast<void *>(&value));
+  test_lib::assert_equal(ptr.tag(), uint64_t{0xDEAD'BEEF'CAFE});
+
+  std::atomic<generic::DoubleWordTaggedPtr> head{generic::DoubleWordTaggedPtr::null()};
+  auto expected = generic::DoubleWordTaggedPtr::null();
+  test_lib::assert_true(head.compare_exchange_strong(expected, ptr));
+  test_lib::assert_false(head.compare_exchange_strong(expected, ptr));
+  test_lib::assert_true(expected == ptr);
+  test_lib::assert_equal(head.load().tag(), uint64_t{0xDEAD'BEEF'CAFE});
+}
+
+enum class ConnectionState : uint8_t { idle, open, closed };
+using ConnectionWord = generic::PackedByte<ConnectionState, bool, uint16_t, uint32_t>;
+
+JOWI_ADD_TEST(packed_byte_get_set) {
+  auto word = ConnectionWord::from_fields(ConnectionState::open, true, 0xFFFF, 7);
+  test_lib::assert_true(word.get<0>() == ConnectionState::open);
+  test_lib::assert_true(word.get<1>());
+  test_lib::assert_equal(word.get<2>(), uint16_t{0xFFFF});
+  test_lib::assert_equal(word.get<3>(), uint32_t{7});
+
+  word.set<2>(3);
+  word.set<1>(false);
+  test_lib::assert_equal(word.get<2>(), uint16_t{3});
+  test_lib::assert_false(word.get<1>());
+  test_lib::assert_equal(word.get<3>(), uint32_t{7});
+  test_lib::assert_true(word.with<0>(ConnectionState::closed).get<0>() == ConnectionState::closed);
+  test_lib::assert_true(word.get<0>() == ConnectionState::open);
+}
+
+JOWI_ADD_TEST(packed_byte_field_wise_fetch_add) {
+  std::atomic<ConnectionWord> word{
+    ConnectionWord::from_fields(ConnectionState::idle, false, 0xFFFF, 0)
+  };
+  auto previous = word.fetch_add<2>(2);
+  test_lib::assert_equal(previous.get<2>(), uint16_t{0xFFFF});
+  test_lib::assert_equal(word.load().get<2>(), uint16_t{1});
+  test_lib::assert_equal(word.load().get<3>(), uint32_t{0});
+
+  word.fetch_sub<3>(1);
+  test_lib::assert_equal(word.load().get<3>(), uint32_t{0xFFFF'FFFF});
+  test_lib::assert_equal(word.load().get<2>(), uint16_t{1});
+  word.fetch_add<3>(1);
+  test_lib::assert_equal(word.load().get<3>(), uint32_t{0});
+}
+
+JOWI_ADD_TEST(packed_byte_concurrent_fetch_update) {
+  constexpr int thread_count = 4;
+  constexpr int per_thread = 10000;
+  std::atomic<ConnectionWord> word{ConnectionWord::from_fields(ConnectionState::idle, false, 0, 0)};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; t += 1) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < per_thread; i += 1) {
+        word.fetch_add<3>(1, std::memory_order_relaxed);
+        word.fetch_update([](ConnectionWord w) {
+          w.set<1>(!w.get<1>());
+          return w.with<2>(static_cast<uint16_t>(w.get<2>() + 1));
+        });
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  auto result = word.load();
+  test_lib::assert_equal(result.get<3>(), uint32_t{thread_count * per_thread});
+  test_lib::assert_equal(result.get<2>(), static_cast<uint16_t>(thread_count * per_thread));
+  test_lib::assert_false(result.get<1>());
+  test_lib::assert_true(result.get<0>() == ConnectionState::idle);
+}
+
+JOWI_ADD_TEST(atomic_stack_is_lifo) {
+  generic::AtomicStack<int> stack;
+  test_lib::assert_true(stack.empty());
+  stack.push(1);
+  stack.push(2);
+  stack.emplace(3);
+  test_lib::assert_false(stack.empty());
+  test_lib::assert_equal(stack.pop().value(), 3);
+  test_lib::assert_equal(stack.pop().value(), 2);
+  test_lib::assert_equal(stack.pop().value(), 1);
+  test_lib::assert_equal(stack.pop().has_value(), false);
+}
+
+JOWI_ADD_TEST(atomic_free_list_recycles_nodes) {
+  struct Node {
+    std::atomic<Node *> next;
+    int value;
+  };
+  generic::AtomicFreeList<Node> free_list;
+  Node *first = free_list.acquire();
+  free_list.release(first);
+  test_lib::assert_equal(free_list.acquire(), first);
+  test_lib::assert_equal(free_list.try_acquire(), static_cast<Node *>(nullptr));
+  free_list.release(first);
+}
+
+template <class HeadType> void run_atomic_stack_concurrent_push_pop() {
+  constexpr int thread_count = 8;
+  constexpr int per_thread = 20000;
+  generic::AtomicStack<int, HeadType> stack;
+  std::atomic<int64_t> popped_sum{0};
+  std::atomic<int> popped_count{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; t += 1) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < per_thread; i += 1) {
+        stack.push(t * per_thread + i);
+        if (auto v = stack.pop(); v) {
+          popped_sum.fetch_add(*v, std::memory_order_relaxed);
+          popped_count.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  while (auto v = stack.pop()) {
+    popped_sum.fetch_add(*v, std::memory_order_relaxed);
+    popped_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  constexpr int64_t total = int64_t{thread_count} * per_thread;
+  test_lib::assert_equal(popped_count.load(), static_cast<int>(total));
+  test_lib::assert_equal(popped_sum.load(), total * (total - 1) / 2);
+}
+
+JOWI_ADD_TEST(atomic_stack_concurrent_push_pop) {
+  run_atomic_stack_concurrent_push_pop<generic::Uint16TaggedPtr>();
+}
+
+JOWI_ADD_TEST(atomic_stack_concurrent_low_bits_head) {
+  run_atomic_stack_concurrent_push_pop<generic::TaggedPtr<uint16_t, generic::LowBitsTag<64>>>();
+}
+
+JOWI_ADD_TEST(atomic_stack_concurrent_double_word_head) {
+  run_atomic_stack_concurrent_push_pop<generic::DoubleWordTaggedPtr>();
+}
+
+JOWI_ADD_TEST(ring_queue_is_fifo_and_bounded) {
+  generic::RingQueue<int> queue{3};
+  test_lib::assert_equal(queue.capacity(), 4u);
+  for (int i = 0; i < 4; i += 1) {
+    test_lib::assert_true(queue.try_push(i));
+  }
+  test_lib::assert_false(queue.try_push(4));
+  test_lib::assert_equal(queue.size(), 4u);
+  for (int i = 0; i < 4; i += 1) {
+    test_lib::assert_equal(queue.try_pop().value(), i);
+  }
+  test_lib::assert_equal(queue.try_pop().has_value(), false);
+  test_lib::assert_true(queue.empty());
+}
+
+JOWI_ADD_TEST(ring_queue_batch_push_pop) {
+  generic::SpscRingQueue<std::string> queue{4};
+  std::vector<std::string> values{"a", "b", "c", "d", "e", "f"};
+  test_lib::assert_equal(queue.try_push_n(values), 4u);
+  test_lib::assert_equal(queue.try_push_n(std::span{values}.subspan(4)), 0u);
+
+  std::vector<std::string> out;
+  test_lib::assert_equal(queue.try_pop_n(std::back_inserter(out), 3), 3u);
+  test_lib::assert_equal(queue.try_push_n(std::span{values}.subspan(4)), 2u);
+  test_lib::assert_equal(queue.try_pop_n(std::back_inserter(out), 10), 3u);
+  test_lib::assert_equal(out == std::vector<std::string>{"a", "b", "c", "d", "e", "f"}, true);
+}
+
+// output iterator that throws once limit values have been written.
+struct ThrowingOutput {
+  using difference_type = std::ptrdiff_t;
+  std::vector<int> *out;
+  size_t limit;
+
+  ThrowingOutput &operator*() {
+    return *this;
+  }
+  ThrowingOutput &operator=(int v) {
+    if (out->size() == limit) {
+      throw std::runtime_error{"full"};
+    }
+    out->push_back(v);
+    return *this;
+  }
+  ThrowingOutput &operator++() {
+    return *this;
+  }
+  ThrowingOutput operator++(int) {
+    return *this;
+  }
+};
+
+JOWI_ADD_TEST(ring_queue_batch_pop_releases_slots_on_throw) {
+  generic::SpscRingQueue<int> queue{4};
+  for (int i = 0; i < 4; i += 1) {
+    queue.try_push(i);
+  }
+  std::vector<int> out;
+  bool threw = false;
+  try {
+    queue.try_pop_n(ThrowingOutput{&out, 1}, 4);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  test_lib::assert_true(threw);
+  test_lib::assert_equal(out.size(), 1u);
+  test_lib::assert_true(queue.empty());
+  for (int i = 0; i < 4; i += 1) {
+    test_lib::assert_true(queue.try_push(i));
+  }
+}
+
+template <class QueueType> void ring_queue_stress(int producer_count, int consumer_count) {
+  constexpr int per_producer = 5000;
+  QueueType queue{64};
+  std::atomic<int64_t> popped_sum{0};
+  std::atomic<int> popped_count{0};
+  const int total = producer_count * per_producer;
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producer_count; p += 1) {
+    threads.emplace_back([&, p]() {
+      std::vector<int> batch;
+      for (int i = 0; i < per_producer;) {
+        if (i % 3 == 0) {
+          batch.assign({p * per_producer + i});
+          for (int j = i + 1; j < per_producer && j < i + 4; j += 1) {
+            batch.push_back(p * per_producer + j);
+          }
+          i += static_cast<int>(queue.try_push_n(batch));
+        } else if (queue.try_push(p * per_producer + i)) {
+          i += 1;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < consumer_count; c += 1) {
+    threads.emplace_back([&]() {
+      std::vector<int> out;
+      while (popped_count.load(std::memory_order_relaxed) < total) {
+        out.clear();
+        if (queue.try_pop_n(std::back_inserter(out), 8) == 0) {
+          std::this_thread::yield();
+        }
+        for (int v : out) {
+          popped_sum.fetch_add(v, std::memory_order_relaxed);
+        }
+        popped_count.fetch_add(static_cast<int>(out.size()), std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  test_lib::assert_equal(popped_count.load(), total);
+  test_lib::assert_equal(popped_sum.load(), int64_t{total} * (total - 1) / 2);
+}
+
+JOWI_ADD_TEST(ring_queue_concurrent_mpmc) {
+  ring_queue_stress<generic::RingQueue<int>>(4, 4);
+}
+
+JOWI_ADD_TEST(ring_queue_concurrent_mpsc) {
+  ring_queue_stress<generic::MpscRingQueue<int>>(4, 1);
+}
+
+JOWI_ADD_TEST(ring_queue_concurrent_spsc) {
+  ring_queue_stress<generic::SpscRingQueue<int>>(1, 1);
+}
+
+JOWI_ADD_TEST(object_pool_reuses_blocks) {
+  generic::ObjectPool<std::string> pool{4};
+  std::string *first = pool.create("hello");
+  test_lib::assert_equal(*first, "hello");
+  pool.destroy(first);
+
+  std::string *second = pool.create("world");
+  test_lib::assert_equal(static_cast<void *>(second), static_cast<void *>(first));
+  pool.destroy(second);
+}
+
+JOWI_ADD_TEST(object_pool_grows_past_slab) {
+  generic::ObjectPool<int64_t> pool{8};
+  std::vector<int64_t *> values;
+  for (int i = 0; i < 1000; i += 1) {
+    values.push_back(pool.create(i));
+  }
+  for (int i = 0; i < 1000; i += 1) {
+    test_lib::assert_equal(*values[i], int64_t{i});
+    test_lib::assert_equal(reinterpret_cast<uintptr_t>(values[i]) % alignof(int64_t), 0u);
+  }
+  for (auto *v : values) {
+    pool.destroy(v);
+  }
+}
+
+JOWI_ADD_TEST(block_pool_blocks_are_not_padded_by_the_free_list_link) {
+  generic::BlockPool<8, 8> pool{16};
+  // consecutive blocks of a fresh slab, the link overlaps the storage instead of following it.
+  auto *a = static_cast<std::byte *>(pool.allocate());
+  auto *b = static_cast<std::byte *>(pool.allocate());
+  test_lib::assert_equal(a - b, 8);
+  pool.deallocate(a);
+  pool.deallocate(b);
+
+  generic::BlockPool<2, 2> tiny{16};
+  auto *c = static_cast<std::byte *>(tiny.allocate());
+  auto *d = static_cast<std::byte *>(tiny.allocate());
+  test_lib::assert_equal(static_cast<size_t>(c - d), sizeof(void *));
+  tiny.deallocate(c);
+  tiny.deallocate(d);
+}
+
+JOWI_ADD_TEST(object_pool_cross_thread_release) {
+  constexpr int thread_count = 4;
+  constexpr int per_thread = 5000;
+  generic::ObjectPool<int> pool{64};
+  generic::RingQueue<int *> handoff{256};
+  std::atomic<int64_t> sum{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; t += 1) {
+    // Producers allocate, consumers free the objects in another thread.
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < per_thread; i += 1) {
+        int *v = pool.create(t * per_thread + i);
+        while (!handoff.try_push(v)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&]() {
+      for (int i = 0; i < per_thread;) {
+        if (auto v = handoff.try_pop(); v) {
+          sum.fetch_add(**v, std::memory_order_relaxed);
+          pool.destroy(*v);
+          i += 1;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  constexpr int64_t total = int64_t{thread_count} * per_thread;
+  test_lib::assert_equal(sum.load(), total * (total - 1) / 2);
+}
+
+JOWI_ADD_TEST(block_pool_resource_serves_pmr_containers) {
+  generic::BlockPoolResource<64> resource{16};
+  std::pmr::list<int> values{&resource};
+  for (int i = 0; i < 100; i += 1) {
+    values.push_back(i);
+  }
+  // Larger requests are forwarded upstream.
+  std::pmr::vector<int> large{&resource};
+  large.resize(1000);
+  test_lib::assert_equal(values.size(), 100u);
+  test_lib::assert_equal(values.back(), 99);
+  test_lib::assert_true(resource.upstream_resource() == std::pmr::get_default_resource());
+}
+
+struct RoutePair {
+  uint64_t first;
+  uint64_t second;
+  uint32_t third;
+};
+
+JOWI_ADD_TEST(seq_lock_load_store_update) {
+  generic::SeqLock<RoutePair> lock{RoutePair{1, 2, 3}};
+  test_lib::assert_equal(lock.load().second, uint64_t{2});
+  test_lib::assert_equal(lock.version(), uint64_t{0});
+  lock.store(RoutePair{4, 5, 6});
+  lock.update([](RoutePair &r) { r.third += 1; });
+  auto value = lock.try_load();
+  test_lib::assert_true(value.has_value());
+  test_lib::assert_equal(value->first, uint64_t{4});
+  test_lib::assert_equal(value->third, uint32_t{7});
+  test_lib::assert_equal(lock.version(), uint64_t{2});
+}
+
+JOWI_ADD_TEST(seq_lock_readers_never_see_torn_values) {
+  constexpr int reader_count = 3;
+  constexpr uint64_t write_count = 20000;
+  generic::SeqLock<RoutePair> lock{RoutePair{0, 0, 0}};
+  std::atomic<bool> done{false};
+  std::atomic<int> torn{0};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < reader_count; t += 1) {
+    readers.emplace_back([&]() {
+      while (!done.load(std::memory_order_relaxed)) {
+        auto value = lock.load();
+        if (value.second != value.first * 2 || value.third != static_cast<uint32_t>(value.first)) {
+          torn.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (uint64_t i = 1; i <= write_count; i += 1) {
+    lock.store(RoutePair{i, i * 2, static_cast<uint32_t>(i)});
+  }
+  done.store(true);
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  test_lib::assert_equal(torn.load(), 0);
+  test_lib::assert_equal(lock.load().first, write_count);
+}
+
+JOWI_ADD_TEST(versioned_snapshot_guard_pins_value) {
+  generic::VersionedSnapshot<std::vector<int>> snapshot{std::vector{1, 2, 3}};
+  test_lib::assert_equal(uint64_t{snapshot.version()}, uint64_t{0});
+  {
+    auto guard = snapshot.read();
+    snapshot.update([](const std::vector<int> &v) {
+      auto next = v;
+      next.push_back(4);
+      return next;
+    });
+    test_lib::assert_equal(guard->size(), size_t{3});
+    test_lib::assert_equal(uint64_t{guard.version()}, uint64_t{0});
+    {
+      auto nested = snapshot.read();
+      test_lib::assert_equal(nested->size(), size_t{4});
+      test_lib::assert_equal(uint64_t{nested.version()}, uint64_t{1});
+    }
+    snapshot.reclaim();
+    test_lib::assert_equal(snapshot.retired_count(), size_t{1});
+  }
+  snapshot.reclaim();
+  test_lib::assert_equal(snapshot.retired_count(), size_t{0});
+  snapshot.store(std::vector{5});
+  test_lib::assert_equal(snapshot.retired_count(), size_t{0});
+  test_lib::assert_equal(snapshot.read()->front(), 5);
+  test_lib::assert_equal(uint64_t{snapshot.version()}, uint64_t{2});
+}
+
+JOWI_ADD_TEST(versioned_snapshot_concurrent_readers) {
+  constexpr int reader_count = 3;
+  constexpr int write_count = 2000;
+  generic::VersionedSnapshot<std::vector<int>> snapshot{std::vector<int>(16, 0)};
+  std::atomic<bool> done{false};
+  std::atomic<int> inconsistent{0};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < reader_count; t += 1) {
+    readers.emplace_back([&]() {
+      while (!done.load(std::memory_order_relaxed)) {
+        auto guard = snapshot.read();
+        for (int v : *guard) {
+          if (v != guard->front()) {
+            inconsistent.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (int i = 1; i <= write_count; i += 1) {
+    snapshot.emplace(16, i);
+  }
+  done.store(true);
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  snapshot.reclaim();
+  test_lib::assert_equal(inconsistent.load(), 0);
+  test_lib::assert_equal(snapshot.read()->back(), write_count);
+  test_lib::assert_equal(snapshot.retired_count(), size_t{0});
+}
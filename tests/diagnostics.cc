@@ -0,0 +1,171 @@
+import jowi.test_lib;
+import jowi.generic;
+#include <jowi/test_lib.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace test_lib = jowi::test_lib;
+namespace generic = jowi::generic;
+
+struct CodeError {
+  int code;
+  const char *what() const noexcept {
+    return code % 2 == 0 ? "even" : "odd";
+  }
+};
+
+struct CollectLines {
+  std::mutex *mut;
+  std::vector<std::string> *lines;
+  void operator()(std::string_view line) const {
+    std::lock_guard l{*mut};
+    lines->emplace_back(line);
+  }
+};
+
+JOWI_ADD_TEST(diagnostics_sink_formats_on_flush) {
+  std::mutex mut;
+  std::vector<std::string> lines;
+  generic::DiagnosticsSink<CollectLines> sink{CollectLines{&mut, &lines}, 4};
+  test_lib::assert_true(sink.record(CodeError{1}));
+  test_lib::assert_true(sink.record(std::runtime_error{"runtime"}));
+  test_lib::assert_true(lines.empty());
+
+  test_lib::assert_equal(sink.flush(), 2);
+  test_lib::assert_equal(lines, std::vector<std::string>{"odd", "runtime"});
+  test_lib::assert_equal(sink.flush(), 0);
+}
+
+JOWI_ADD_TEST(diagnostics_sink_drops_when_full) {
+  std::mutex mut;
+  std::vector<std::string> lines;
+  generic::DiagnosticsSink<CollectLines, generic::FixedErrorFormatter<4>> sink{
+    CollectLines{&mut, &lines}, 2
+  };
+  test_lib::assert_true(sink.record(CodeError{2}));
+  test_lib::assert_true(sink.record(std::runtime_error{"truncated"}));
+  test_lib::assert_false(sink.record(CodeError{3}));
+  test_lib::assert_equal(sink.dropped(), 1);
+  sink.flush();
+  test_lib::assert_equal(lines, std::vector<std::string>{"even", "trun"});
+}
+
+// counts how many times it was asked for its message.
+struct CountingError {
+  int *calls;
+  const char *what() const noexcept {
+    *calls += 1;
+    return "counted";
+  }
+};
+
+JOWI_ADD_TEST(diagnostics_sink_full_ring_skips_construction) {
+  std::mutex mut;
+  std::vector<std::string> lines;
+  generic::DiagnosticsSink<CollectLines, generic::FixedErrorFormatter<16>> sink{
+    CollectLines{&mut, &lines}, 2
+  };
+  int calls = 0;
+  test_lib::assert_true(sink.record(CountingError{&calls}));
+  test_lib::assert_true(sink.record(CountingError{&calls}));
+  test_lib::assert_false(sink.record(CountingError{&calls}));
+  test_lib::assert_equal(calls, 2);
+  test_lib::assert_equal(sink.dropped(), 1);
+}
+
+JOWI_ADD_TEST(diagnostics_sink_background_flush) {
+  std::mutex mut;
+  std::vector<std::string> lines;
+  {
+    generic::DiagnosticsSink<CollectLines> sink{CollectLines{&mut, &lines}, 64};
+    sink.run_in_background(std::chrono::milliseconds{1});
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < 4; t += 1) {
+      threads.emplace_back([&]() {
+        for (int i = 0; i < 500; i += 1) {
+          while (!sink.record(CodeError{i})) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    threads.clear();
+  }
+  test_lib::assert_equal(lines.size(), 2000);
+  test_lib::assert_equal(std::ranges::count(lines, "even"), 1000);
+}
+
+// throws for every line containing "odd".
+struct ThrowOnOdd {
+  std::mutex *mut;
+  std::vector<std::string> *lines;
+  void operator()(std::string_view line) const {
+    if (line == "odd") {
+      throw std::runtime_error{"write failed"};
+    }
+    std::lock_guard l{*mut};
+    lines->emplace_back(line);
+  }
+};
+
+JOWI_ADD_TEST(diagnostics_sink_survives_throwing_writer) {
+  std::mutex mut;
+  std::vector<std::string> lines;
+  {
+    generic::DiagnosticsSink<ThrowOnOdd> sink{ThrowOnOdd{&mut, &lines}, 64};
+    sink.run_in_background(std::chrono::milliseconds{1});
+    for (int i = 0; i < 8; i += 1) {
+      sink.record(CodeError{i});
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (sink.failed_flushes() != 4 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    test_lib::assert_equal(sink.failed_flushes(), 4);
+    // left for the destructor, which has to get past the throwing entries as well.
+    sink.record(CodeError{1});
+    sink.record(CodeError{2});
+  }
+  test_lib::assert_equal(lines.size(), 5);
+}
+
+JOWI_ADD_TEST(diagnostics_sink_thread_outlives_sink) {
+  std::mutex mut;
+  std::vector<std::string> lines;
+  std::optional<generic::DiagnosticsSink<CollectLines>> first;
+  first.emplace(CollectLines{&mut, &lines});
+  std::mutex step_mut;
+  std::condition_variable step_cv;
+  int step = 0;
+  std::jthread worker{[&]() {
+    first->record(CodeError{1});
+    {
+      std::unique_lock l{step_mut};
+      step = 1;
+      step_cv.notify_all();
+      step_cv.wait(l, [&]() { return step == 2; });
+    }
+    // the first sink is gone, a new sink at the same address must get a new ring.
+    first->record(CodeError{2});
+  }};
+  {
+    std::unique_lock l{step_mut};
+    step_cv.wait(l, [&]() { return step == 1; });
+    first.reset();
+    first.emplace(CollectLines{&mut, &lines});
+    step = 2;
+    step_cv.notify_all();
+  }
+  worker.join();
+  test_lib::assert_equal(first->flush(), 1);
+  test_lib::assert_equal(lines, std::vector<std::string>{"odd", "even"});
+}
@@ -1,7 +1,13 @@
 import jowi.test_lib;
 import jowi.generic;
 #include <jowi/test_lib.hpp>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace test_lib = jowi::test_lib;
 namespace generic = jowi::generic;
@@ -190,4 +196,234 @@ JOWI_ADD_TEST(construction_with_undeflow_string) {
   generic::FixedString<10> fs{std::string{"HELLO"}};
   test_lib::assert_equal(fs, "HELLO");
   test_lib::assert_equal(fs.length(), 5);
-}
\ No newline at end of file
+}
+JOWI_ADD_TEST(equality_operator_between_fixed_strings) {
+  generic::FixedString<40> long_fs{"a message that is longer than one block"};
+  generic::FixedString<64> same{"a message that is longer than one block"};
+  generic::FixedString<64> other{"a message that is longer than one block!"};
+
+  test_lib::assert_equal(long_fs == same, true);
+  test_lib::assert_equal(long_fs == other, false);
+  other.unsafe_set_length(long_fs.length());
+  test_lib::assert_equal(long_fs == other, true);
+}
+
+JOWI_ADD_TEST(three_way_comparison_matches_string_view) {
+  generic::FixedString<32> apple{"apple pie with cream on top"};
+  generic::FixedString<32> apricot{"apple pie with cream on tops"};
+  generic::FixedString<32> high{"apple pie with cream on t\xff"};
+
+  test_lib::assert_true(apple < apricot);
+  test_lib::assert_true(apricot > apple);
+  test_lib::assert_true(apple < high);
+  test_lib::assert_true((apple <=> apple) == 0);
+  test_lib::assert_true(apple < std::string_view{"banana"});
+  test_lib::assert_true(apple > std::string_view{"apple"});
+}
+
+JOWI_ADD_TEST(find_contains_and_starts_with) {
+  generic::FixedString<48> fs{"connection refused by host: example.org:443"};
+
+  test_lib::assert_equal(fs.find(':').value(), 26);
+  test_lib::assert_equal(fs.find(':', 27).value(), 39);
+  test_lib::assert_equal(fs.find('!').has_value(), false);
+  test_lib::assert_equal(fs.find("example").value(), 28);
+  test_lib::assert_equal(fs.find("443").value(), 40);
+  test_lib::assert_equal(fs.find("4434").has_value(), false);
+  test_lib::assert_true(fs.contains("refused"));
+  test_lib::assert_false(fs.contains("accepted"));
+  test_lib::assert_true(fs.starts_with("connection"));
+  test_lib::assert_true(fs.ends_with(":443"));
+  test_lib::assert_false(fs.starts_with("host"));
+
+  // characters past the length are never matched.
+  fs.unsafe_set_length(10);
+  test_lib::assert_equal(fs.find(':').has_value(), false);
+  test_lib::assert_false(fs.contains("refused"));
+}
+
+JOWI_ADD_TEST(hash_ignores_capacity_and_stale_bytes) {
+  generic::FixedString<16> fs{"identifier"};
+  generic::FixedString<64> wide{"identifier"};
+  generic::FixedString<16> stale{"identifier_xyz"};
+  stale.unsafe_set_length(10);
+
+  std::hash<generic::FixedString<16>> hasher;
+  test_lib::assert_equal(hasher(fs), hasher(stale));
+  test_lib::assert_equal(fs.hash(), wide.hash());
+  test_lib::assert_true(fs.hash() != generic::FixedString<16>{"identifies"}.hash());
+
+  std::unordered_map<generic::FixedString<16>, int> ids;
+  ids.emplace(fs, 1);
+  ids.emplace(generic::FixedString<16>{"other"}, 2);
+  test_lib::assert_equal(ids.at(stale), 1);
+}
+
+JOWI_ADD_TEST(emplace_format_appends_to_existing_content) {
+  generic::FixedString<16> fs{"code="};
+  fs.emplace_format("{}:{}", 404, "not found");
+  test_lib::assert_equal(fs, "code=404:not fou");
+  test_lib::assert_equal(fs.length(), 16);
+  test_lib::assert_true(fs.truncated());
+  test_lib::assert_equal(*fs.end(), '\0');
+
+  fs.truncate();
+  test_lib::assert_false(fs.truncated());
+  fs.emplace_format("{}", 12);
+  test_lib::assert_equal(fs, "12");
+  test_lib::assert_false(fs.truncated());
+}
+
+JOWI_ADD_TEST(append_string_int_and_float) {
+  generic::FixedString<32> fs;
+  fs.append("errno ").append_int(-13).append(" after ").append_float(1.5).append("s");
+  test_lib::assert_equal(fs, "errno -13 after 1.5s");
+  test_lib::assert_false(fs.truncated());
+
+  fs.truncate();
+  fs.append_int(255, 16).append(" ").append_float(2.71828, std::chars_format::fixed, 2);
+  test_lib::assert_equal(fs, "ff 2.72");
+}
+
+JOWI_ADD_TEST(append_keeps_prefix_and_marks_truncation) {
+  generic::FixedString<8> fs{"id "};
+  fs.append_int(123456789);
+  test_lib::assert_equal(fs, "id 12345");
+  test_lib::assert_true(fs.truncated());
+
+  generic::FixedString<4> small;
+  small.append("abcdef");
+  test_lib::assert_equal(small, "abcd");
+  test_lib::assert_true(small.truncated());
+  small.push_back('e');
+  test_lib::assert_equal(small, "abcd");
+
+  generic::FixedString<4> from_view{std::string_view{"abcdef"}};
+  test_lib::assert_true(from_view.truncated());
+}
+
+JOWI_ADD_TEST(small_string_stays_inline_then_spills) {
+  generic::SmallString<8> s{"abc"};
+  test_lib::assert_true(s.is_inline());
+  test_lib::assert_equal(s.capacity(), 8);
+  s.append("defgh");
+  test_lib::assert_true(s.is_inline());
+  test_lib::assert_equal(s, "abcdefgh");
+
+  s.push_back('i');
+  test_lib::assert_false(s.is_inline());
+  test_lib::assert_equal(s, "abcdefghi");
+  test_lib::assert_equal(*s.end(), '\0');
+  s.append_int(-42).append(" ").append_float(0.5);
+  test_lib::assert_equal(s, "abcdefghi-42 0.5");
+
+  s.truncate();
+  s.append("xy");
+  s.shrink_to_fit();
+  test_lib::assert_true(s.is_inline());
+  test_lib::assert_equal(s, "xy");
+}
+
+JOWI_ADD_TEST(small_string_shrink_to_fit_on_heap_is_exact) {
+  generic::SmallString<8> s{"abcdefghijkl"};
+  s.reserve(64);
+  s.shrink_to_fit();
+  test_lib::assert_false(s.is_inline());
+  test_lib::assert_equal(s.capacity(), 12);
+  test_lib::assert_equal(s, "abcdefghijkl");
+  test_lib::assert_equal(*s.end(), '\0');
+}
+
+JOWI_ADD_TEST(small_string_emplace_format_grows) {
+  generic::SmallString<8> s{"id="};
+  s.emplace_format("{}", 42);
+  test_lib::assert_true(s.is_inline());
+  s.emplace_format("/{}/{}", "a longer path segment", 7);
+  test_lib::assert_equal(s, "id=42/a longer path segment/7");
+  test_lib::assert_equal(s.length(), 29);
+}
+
+JOWI_ADD_TEST(small_string_copy_and_move) {
+  generic::SmallString<4> heap{"longer than four"};
+  generic::SmallString<4> inline_s{"abc"};
+
+  auto heap_copy = heap;
+  test_lib::assert_equal(heap_copy, heap);
+  const char *heap_data = heap.c_str();
+  auto moved = std::move(heap);
+  test_lib::assert_equal(moved.c_str(), heap_data);
+  test_lib::assert_equal(heap.length(), 0);
+  test_lib::assert_true(heap.is_inline());
+
+  auto moved_inline = std::move(inline_s);
+  test_lib::assert_equal(moved_inline, "abc");
+  moved_inline = heap_copy;
+  test_lib::assert_equal(moved_inline, "longer than four");
+  heap_copy = std::move(moved);
+  test_lib::assert_equal(heap_copy, "longer than four");
+}
+
+JOWI_ADD_TEST(small_string_converts_from_and_to_fixed_string) {
+  generic::FixedString<16> fixed{"routing table"};
+  generic::SmallString<16> small{fixed};
+  test_lib::assert_true(small.is_inline());
+  test_lib::assert_true(small == fixed);
+  test_lib::assert_true(fixed == small);
+  test_lib::assert_equal(small.hash(), fixed.hash());
+  test_lib::assert_true(small.to_fixed_string() == fixed);
+
+  small.append(" that overflowed");
+  auto truncated = small.to_fixed_string();
+  test_lib::assert_equal(truncated, "routing table th");
+  test_lib::assert_true(truncated.truncated());
+  test_lib::assert_true(small > fixed);
+}
+
+JOWI_ADD_TEST(small_string_search_and_hash) {
+  generic::SmallString<8> s{"a heap allocated message: key=value"};
+  test_lib::assert_equal(s.find('=').value(), 29);
+  test_lib::assert_equal(s.find("key").value(), 26);
+  test_lib::assert_true(s.contains("message"));
+  test_lib::assert_true(s.starts_with("a heap"));
+
+  std::unordered_map<generic::SmallString<8>, int> ids;
+  ids.emplace(s, 1);
+  test_lib::assert_equal(ids.at(generic::SmallString<8>{std::string_view{s}}), 1);
+}
+
+JOWI_ADD_TEST(pmr_small_string_allocates_from_resource) {
+  std::array<std::byte, 256> buffer;
+  std::pmr::monotonic_buffer_resource resource{
+    buffer.data(), buffer.size(), std::pmr::null_memory_resource()
+  };
+  generic::pmr::SmallString<8> s{"inline", &resource};
+  test_lib::assert_true(s.is_inline());
+  s.append(" and then some more");
+  test_lib::assert_false(s.is_inline());
+  test_lib::assert_true(s.get_allocator().resource() == &resource);
+  test_lib::assert_equal(s, "inline and then some more");
+}
+
+template <generic::FixedString Name> constexpr std::string_view name_of() {
+  return generic::interned<Name>;
+}
+
+JOWI_ADD_TEST(fixed_string_as_template_argument) {
+  constexpr std::string_view first = name_of<"config.reload">();
+  constexpr std::string_view second = generic::interned<"config.reload">;
+  test_lib::assert_equal(first, std::string_view{"config.reload"});
+  test_lib::assert_equal(first.data(), second.data());
+  test_lib::assert_true(first.data() != generic::interned<"config.reload!">.data());
+}
+
+JOWI_ADD_TEST(fixed_string_interned_ignores_capacity_and_truncation) {
+  constexpr generic::FixedString<32> wide{"config"};
+  // cut from a longer string, the text is equal but the truncated flag is set.
+  constexpr generic::FixedString<6> cut{std::string_view{"config.reload"}};
+  static_assert(cut.truncated());
+  static_assert(wide == cut);
+  constexpr std::string_view literal = generic::interned<"config">;
+  test_lib::assert_equal(generic::interned<wide>.data(), literal.data());
+  test_lib::assert_equal(generic::interned<cut>.data(), literal.data());
+  test_lib::assert_equal(generic::interned<cut>, std::string_view{"config"});
+}
@@ -0,0 +1,68 @@
+import jowi.test_lib;
+import jowi.generic;
+#include <jowi/test_lib.hpp>
+#include <array>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace test_lib = jowi::test_lib;
+namespace generic = jowi::generic;
+
+static int formatted = 0;
+
+struct CountedError {
+  const char *what() const noexcept {
+    formatted += 1;
+    return "counted error";
+  }
+};
+
+struct LargeError {
+  std::array<char, 256> padding{};
+  std::string reason;
+  const char *what() const noexcept {
+    return reason.c_str();
+  }
+};
+
+JOWI_ADD_TEST(error_formatter_formats_eagerly) {
+  generic::ErrorFormatter e{std::runtime_error{"eager"}};
+  test_lib::assert_equal(e.msg, "eager");
+  test_lib::assert_equal(std::format("{}", e), "eager");
+}
+
+JOWI_ADD_TEST(lazy_error_formatter_formats_on_demand) {
+  formatted = 0;
+  generic::LazyErrorFormatter<> e{CountedError{}};
+  test_lib::assert_equal(formatted, 0);
+  test_lib::assert_equal(std::format("{}", e), "counted error");
+  test_lib::assert_equal(formatted, 1);
+
+  generic::LazyErrorFormatter<> copy{e};
+  generic::LazyErrorFormatter<> moved{std::move(e)};
+  test_lib::assert_equal(std::format("{}", e), "");
+  test_lib::assert_equal(copy.message(), "counted error");
+  test_lib::assert_equal(moved.message(), "counted error");
+}
+
+JOWI_ADD_TEST(lazy_error_formatter_large_error_on_heap) {
+  generic::LazyErrorFormatter<16> e{LargeError{{}, "too large to be inline"}};
+  generic::LazyErrorFormatter<16> other{std::runtime_error{"other"}};
+  other = e;
+  test_lib::assert_equal(other.message(), "too large to be inline");
+  e = std::move(other);
+  test_lib::assert_equal(e.message(), "too large to be inline");
+  test_lib::assert_equal(other.message(), "");
+}
+
+JOWI_ADD_TEST(fixed_error_formatter_truncates) {
+  generic::FixedErrorFormatter<8> e{std::runtime_error{"short"}};
+  test_lib::assert_equal(std::format("{}", e), "short");
+  test_lib::assert_false(e.truncated());
+
+  generic::FixedErrorFormatter<8> cut{std::runtime_error{"much too long"}};
+  test_lib::assert_equal(std::format("{}", cut), "much too");
+  test_lib::assert_true(cut.truncated());
+}
@@ -1,7 +1,18 @@
 import jowi.test_lib;
 import jowi.generic;
 #include <jowi/test_lib.hpp>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <ranges>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace test_lib = jowi::test_lib;
@@ -202,4 +213,428 @@ JOWI_ADD_TEST(key_vector_empty_after_removal) {
   test_lib::assert_equal(removed.has_value(), true);
   test_lib::assert_equal(kv.empty(), true);
   test_lib::assert_equal(kv.size(), 0u);
-}
\ No newline at end of file
+}
+JOWI_ADD_TEST(split_key_vector_get_and_emplace) {
+  generic::SplitKeyVector<int, std::string> kv{{1, "one"}, {2, "two"}, {3, "three"}};
+
+  test_lib::assert_equal(kv.size(), 3u);
+  test_lib::assert_equal(kv.get(2).value().get(), "two");
+  test_lib::assert_equal(kv.get(99).has_value(), false);
+
+  kv.emplace(2, "TWO");
+  kv.emplace(4, "four");
+  test_lib::assert_equal(kv.size(), 4u);
+  test_lib::assert_equal(kv[2].value().get(), "TWO");
+  test_lib::assert_equal(kv[4].value().get(), "four");
+}
+
+struct ThrowingValue {
+  int value;
+  ThrowingValue(int v) : value{v} {
+    if (v < 0) {
+      throw std::invalid_argument{"negative"};
+    }
+  }
+};
+
+JOWI_ADD_TEST(split_key_vector_emplace_throwing_value_keeps_keys_aligned) {
+  generic::SplitKeyVector<int, ThrowingValue> kv;
+  kv.emplace(1, 10);
+  bool thrown = false;
+  try {
+    kv.emplace(2, -1);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  test_lib::assert_true(thrown);
+  test_lib::assert_equal(kv.size(), 1u);
+  test_lib::assert_false(kv.get(2).has_value());
+  kv.emplace(3, 30);
+  test_lib::assert_equal(kv.get(3).value().get().value, 30);
+  test_lib::assert_equal(kv.get(1).value().get().value, 10);
+}
+
+JOWI_ADD_TEST(split_key_vector_scans_past_vector_width) {
+  generic::SplitKeyVector<uint8_t, int> small_keys;
+  generic::SplitKeyVector<int64_t, int> wide_keys;
+  for (int i = 0; i < 100; i += 1) {
+    small_keys.emplace(static_cast<uint8_t>(i), i);
+    wide_keys.emplace(static_cast<int64_t>(i) << 33, i);
+  }
+
+  for (int i = 0; i < 100; i += 1) {
+    test_lib::assert_equal(small_keys.get(static_cast<uint8_t>(i)).value().get(), i);
+    test_lib::assert_equal(wide_keys.get(static_cast<int64_t>(i) << 33).value().get(), i);
+  }
+  test_lib::assert_equal(small_keys.get(static_cast<uint8_t>(200)).has_value(), false);
+  // Only the upper half matches, this must not be reported as a hit.
+  test_lib::assert_equal(wide_keys.get(int64_t{1} << 33 | 1).has_value(), false);
+  // Queries that do not fit in the key type are never found.
+  test_lib::assert_equal(small_keys.get(256 + 1).has_value(), false);
+}
+
+JOWI_ADD_TEST(split_key_vector_remove_keeps_order) {
+  generic::SplitKeyVector<int, std::string> kv{{5, "five"}, {15, "fifteen"}, {25, "twenty-five"}};
+
+  auto removed = kv.remove(15);
+  test_lib::assert_equal(removed.value(), "fifteen");
+  test_lib::assert_equal(kv.size(), 2u);
+  test_lib::assert_equal(kv.keys()[0], 5);
+  test_lib::assert_equal(kv.keys()[1], 25);
+  test_lib::assert_equal(kv.values()[1], "twenty-five");
+}
+
+JOWI_ADD_TEST(split_key_vector_iteration) {
+  generic::SplitKeyVector<int, std::string> kv{{1, "one"}, {2, "two"}};
+
+  for (auto [key, value] : kv) {
+    value += "!";
+  }
+
+  int count = 0;
+  for (const auto &[key, value] : std::as_const(kv)) {
+    count++;
+    test_lib::assert_equal(value.back(), '!');
+  }
+  test_lib::assert_equal(count, 2);
+}
+
+JOWI_ADD_TEST(key_vector_iteration_keeps_keys_const) {
+  generic::KeyVector<int, int, 4> kv;
+  for (int i = 0; i < 16; i += 1) {
+    kv.emplace(i, i);
+  }
+  static_assert(std::same_as<decltype((*kv.begin()).first), const int &>);
+  static_assert(std::same_as<decltype(kv.begin()->first), const int &>);
+  for (auto [key, value] : kv) {
+    value = key * 2;
+  }
+  kv.begin()->second = 100;
+  test_lib::assert_equal(kv.get(0).value().get(), 100);
+  test_lib::assert_equal(kv.get(15).value().get(), 30);
+
+  static_assert(std::ranges::random_access_range<generic::KeyVector<int, int, 4>>);
+  test_lib::assert_equal(kv.end() - kv.begin(), 16);
+  test_lib::assert_equal((kv.begin() + 3)->first, 3);
+  test_lib::assert_equal(kv.begin()[5].second, 10);
+  test_lib::assert_equal((kv.end() - 1)->first, 15);
+  test_lib::assert_true(kv.begin() < kv.end());
+}
+
+// memory resource counting its allocations, throws bad_alloc while fail is set.
+struct FailingResource : std::pmr::memory_resource {
+  bool fail = false;
+  size_t allocations = 0;
+
+  void *do_allocate(size_t bytes, size_t align) override {
+    if (fail) {
+      throw std::bad_alloc{};
+    }
+    allocations += 1;
+    return std::pmr::new_delete_resource()->allocate(bytes, align);
+  }
+  void do_deallocate(void *p, size_t bytes, size_t align) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+    return this == &o;
+  }
+};
+
+JOWI_ADD_TEST(key_vector_index_survives_failed_rebuild) {
+  FailingResource resource;
+  generic::pmr::KeyVector<int, int, 4> kv{&resource};
+  kv.reserve(64);
+  for (int i = 0; i < 8; i += 1) {
+    kv.emplace(i, i);
+  }
+  test_lib::assert_true(kv.is_indexed());
+  // the ninth entry outgrows the index, its rebuild has to allocate.
+  resource.fail = true;
+  bool threw = false;
+  try {
+    kv.emplace(8, 8);
+  } catch (const std::bad_alloc &) {
+    threw = true;
+  }
+  resource.fail = false;
+  test_lib::assert_true(threw);
+  test_lib::assert_equal(kv.size(), 8u);
+  for (int i = 0; i < 8; i += 1) {
+    test_lib::assert_equal(kv.get(i).value().get(), i);
+  }
+  test_lib::assert_false(kv.get(8).has_value());
+  kv.emplace(8, 8);
+  test_lib::assert_equal(kv.get(8).value().get(), 8);
+}
+
+JOWI_ADD_TEST(key_vector_builds_index_past_threshold) {
+  generic::KeyVector<int, int, 8> kv;
+  for (int i = 0; i < 7; i += 1) {
+    kv.emplace(i * 1024, i);
+  }
+  test_lib::assert_false(kv.is_indexed());
+
+  for (int i = 7; i < 1000; i += 1) {
+    kv.emplace(i * 1024, i);
+  }
+  test_lib::assert_true(kv.is_indexed());
+  for (int i = 0; i < 1000; i += 1) {
+    test_lib::assert_equal(kv.get(i * 1024).value().get(), i);
+  }
+  test_lib::assert_equal(kv.get(1).has_value(), false);
+  test_lib::assert_equal(kv.get(static_cast<long long>(5 * 1024)).value().get(), 5);
+}
+
+JOWI_ADD_TEST(key_vector_indexed_keeps_insertion_order) {
+  generic::KeyVector<std::string, int, 4> kv;
+  for (int i = 0; i < 16; i += 1) {
+    kv.emplace(std::to_string(i), i);
+  }
+  kv.emplace("3", 300);
+  test_lib::assert_equal(kv.size(), 16u);
+  test_lib::assert_equal(kv.get(std::string_view{"3"}).value().get(), 300);
+
+  int expected = 0;
+  for (const auto &[key, value] : kv) {
+    test_lib::assert_equal(key, std::to_string(expected));
+    expected += 1;
+  }
+}
+
+JOWI_ADD_TEST(key_vector_indexed_remove) {
+  generic::KeyVector<int, int, 4> kv;
+  for (int i = 0; i < 10; i += 1) {
+    kv.emplace(i, i);
+  }
+  test_lib::assert_equal(kv.remove(4).value(), 4);
+  test_lib::assert_equal(kv.get(4).has_value(), false);
+  test_lib::assert_equal(kv.get(9).value().get(), 9);
+
+  for (int i = 0; i < 9; i += 1) {
+    kv.remove(i);
+  }
+  test_lib::assert_false(kv.is_indexed());
+  test_lib::assert_equal(kv.get(9).value().get(), 9);
+}
+
+JOWI_ADD_TEST(sorted_key_vector_iteration_keeps_keys_const) {
+  generic::SortedKeyVector<int, int, generic::SortedLayout::eytzinger> kv;
+  for (int i = 0; i < 16; i += 1) {
+    kv.emplace(i, i);
+  }
+  static_assert(std::same_as<decltype((*kv.begin()).first), const int &>);
+  int previous = -1;
+  for (auto [key, value] : kv) {
+    test_lib::assert_true(key > previous);
+    previous = key;
+    value = -key;
+  }
+  test_lib::assert_equal(kv.get(7).value().get(), -7);
+}
+
+JOWI_ADD_TEST(sorted_key_vector_bulk_construction) {
+  std::vector<std::pair<int, std::string>> container{
+    {30, "thirty"}, {10, "ten"}, {20, "twenty"}, {10, "TEN"}
+  };
+  generic::SortedKeyVector<int, std::string> kv{std::move(container)};
+
+  test_lib::assert_equal(kv.size(), 3u);
+  test_lib::assert_equal(kv.get(10).value().get(), "TEN");
+  test_lib::assert_equal(kv.get(20).value().get(), "twenty");
+  test_lib::assert_equal(kv.get(25).has_value(), false);
+
+  std::vector<int> keys_vec;
+  for (const auto &key : kv.keys()) {
+    keys_vec.push_back(key);
+  }
+  test_lib::assert_equal(keys_vec == std::vector<int>{10, 20, 30}, true);
+}
+
+JOWI_ADD_TEST(sorted_key_vector_emplace_and_remove) {
+  generic::SortedKeyVector<std::string, int> kv{{"b", 2}, {"d", 4}};
+
+  kv.emplace("c", 3);
+  kv.emplace("a", 1);
+  kv.emplace("d", 40);
+  test_lib::assert_equal(kv.size(), 4u);
+  test_lib::assert_equal(kv.begin()->first, "a");
+  test_lib::assert_equal(kv.get(std::string_view{"d"}).value().get(), 40);
+
+  test_lib::assert_equal(kv.remove("b").value(), 2);
+  test_lib::assert_equal(kv.remove("b").has_value(), false);
+  test_lib::assert_equal(kv.size(), 3u);
+}
+
+JOWI_ADD_TEST(sorted_key_vector_eytzinger_layout) {
+  for (int n = 0; n < 70; n += 1) {
+    std::vector<std::pair<int, int>> container;
+    for (int i = n - 1; i >= 0; i -= 1) {
+      container.emplace_back(i * 2, i);
+    }
+    generic::SortedKeyVector<int, int, generic::SortedLayout::eytzinger> kv{std::move(container)};
+    for (int i = 0; i < n; i += 1) {
+      test_lib::assert_equal(kv.get(i * 2).value().get(), i);
+      test_lib::assert_equal(kv.get(i * 2 + 1).has_value(), false);
+    }
+    test_lib::assert_equal(kv.get(-1).has_value(), false);
+  }
+
+  generic::SortedKeyVector<int, int, generic::SortedLayout::eytzinger> kv;
+  kv.emplace(5, 50);
+  kv.emplace(1, 10);
+  kv.emplace(3, 30);
+  kv.remove(1);
+  test_lib::assert_equal(kv.get(3).value().get(), 30);
+  test_lib::assert_equal(kv.get(5).value().get(), 50);
+  test_lib::assert_equal(kv.get(1).has_value(), false);
+}
+
+JOWI_ADD_TEST(pmr_key_vector_uses_resource) {
+  std::array<std::byte, 4096> buf;
+  std::pmr::monotonic_buffer_resource resource{
+    buf.data(), buf.size(), std::pmr::null_memory_resource()
+  };
+  generic::pmr::KeyVector<int, int, 8> kv{&resource};
+
+  for (int i = 0; i < 32; i += 1) {
+    kv.emplace(i, i * 2);
+  }
+  test_lib::assert_true(kv.is_indexed());
+  test_lib::assert_equal(kv.get(31).value().get(), 62);
+  test_lib::assert_true(kv.get_allocator().resource() == &resource);
+}
+
+JOWI_ADD_TEST(inline_key_vector_stays_inline_until_full) {
+  generic::InlineKeyVector<int, int, 4> kv{{1, 10}, {2, 20}};
+  test_lib::assert_true(kv.is_inline());
+  kv.emplace(3, 30);
+  kv.emplace(4, 40);
+  test_lib::assert_true(kv.is_inline());
+
+  kv.emplace(5, 50);
+  test_lib::assert_false(kv.is_inline());
+  test_lib::assert_equal(kv.size(), 5u);
+  test_lib::assert_equal(kv.get(5).value().get(), 50);
+}
+
+JOWI_ADD_TEST(inline_key_vector_copy_uses_own_buffer) {
+  generic::InlineKeyVector<int, std::string, 4> kv{{1, "one"}, {2, "two"}};
+  generic::InlineKeyVector<int, std::string, 4> copy{kv};
+  generic::InlineKeyVector<int, std::string, 4> moved{std::move(kv)};
+
+  test_lib::assert_true(copy.is_inline());
+  test_lib::assert_true(moved.is_inline());
+  test_lib::assert_equal(copy.get(1).value().get(), "one");
+  test_lib::assert_equal(moved.get(2).value().get(), "two");
+}
+
+JOWI_ADD_TEST(key_vector_get_many) {
+  generic::KeyVector<int, std::string> kv{{1, "one"}, {2, "two"}, {3, "three"}};
+
+  std::array<int, 3> keys{3, 42, 1};
+  auto fixed = kv.get_many(std::span{keys});
+  test_lib::assert_equal(fixed.size(), 3u);
+  test_lib::assert_equal(fixed[0].value().get(), "three");
+  test_lib::assert_equal(fixed[1].has_value(), false);
+  test_lib::assert_equal(fixed[2].value().get(), "one");
+
+  std::vector<int> dynamic_keys{2, 2};
+  auto dynamic = std::as_const(kv).get_many(std::span<const int>{dynamic_keys});
+  test_lib::assert_equal(dynamic.size(), 2u);
+  test_lib::assert_equal(dynamic[0].value().get(), "two");
+  test_lib::assert_equal(dynamic[1].value().get(), "two");
+}
+
+JOWI_ADD_TEST(key_vector_get_many_indexed) {
+  generic::KeyVector<int, int, 4> kv;
+  for (int i = 0; i < 64; i += 1) {
+    kv.emplace(i, i * 10);
+  }
+  std::array<int, 2> keys{63, 64};
+  auto result = kv.get_many(std::span{keys});
+  result[0].value().get() = 1;
+  test_lib::assert_equal(kv.get(63).value().get(), 1);
+  test_lib::assert_equal(result[1].has_value(), false);
+}
+
+JOWI_ADD_TEST(key_vector_insert_range) {
+  generic::KeyVector<int, std::string, 4> kv{{1, "one"}};
+  std::vector<std::pair<int, std::string>> entries{
+    {2, "two"}, {1, "ONE"}, {3, "three"}, {2, "TWO"}, {4, "four"}, {5, "five"}
+  };
+  kv.insert_range(entries);
+
+  test_lib::assert_equal(kv.size(), 5u);
+  test_lib::assert_true(kv.is_indexed());
+  test_lib::assert_equal(kv.get(1).value().get(), "ONE");
+  test_lib::assert_equal(kv.get(2).value().get(), "TWO");
+  test_lib::assert_equal(kv.keys()[4], 5);
+}
+
+JOWI_ADD_TEST(key_vector_insert_range_into_empty_map_builds_index_once) {
+  FailingResource resource;
+  generic::pmr::KeyVector<int, int, 4> kv{&resource};
+  std::vector<std::pair<int, int>> entries;
+  for (int i = 0; i < 100; i += 1) {
+    entries.emplace_back(i % 60, i);
+  }
+  kv.insert_range(entries);
+
+  // one allocation for the entries, one for the index.
+  test_lib::assert_equal(resource.allocations, 2u);
+  test_lib::assert_true(kv.is_indexed());
+  test_lib::assert_equal(kv.size(), 60u);
+  test_lib::assert_equal(kv.get(10).value().get(), 70);
+  test_lib::assert_equal(kv.get(59).value().get(), 59);
+}
+
+JOWI_ADD_TEST(key_vector_remove_if) {
+  generic::KeyVector<int, int, 4> kv;
+  for (int i = 0; i < 20; i += 1) {
+    kv.emplace(i, i);
+  }
+  auto removed = kv.remove_if([](int key, int &) { return key % 2 == 0; });
+
+  test_lib::assert_equal(removed, 10u);
+  test_lib::assert_equal(kv.size(), 10u);
+  test_lib::assert_equal(kv.get(4).has_value(), false);
+  test_lib::assert_equal(kv.get(5).value().get(), 5);
+  test_lib::assert_equal(kv.keys()[0], 1);
+}
+
+JOWI_ADD_TEST(hashed_string_compares_hash_first) {
+  generic::HashedString<> key{"content-type"};
+  test_lib::assert_equal(key.hash, generic::string_hash("content-type"));
+  test_lib::assert_true(key == generic::HashedStringView{"content-type"});
+  test_lib::assert_false(key == generic::HashedStringView{"content-length"});
+  // A mismatching cached hash rejects the key without looking at the characters.
+  test_lib::assert_false(key == generic::HashedStringView{"content-type", key.hash + 1});
+}
+
+JOWI_ADD_TEST(key_vector_hashed_string_keys) {
+  generic::KeyVector<generic::HashedString<>, int, 8> kv{{"host", 1}, {"accept", 2}};
+
+  test_lib::assert_equal(kv.get("host").value().get(), 1);
+  test_lib::assert_equal(kv.get(std::string_view{"accept"}).value().get(), 2);
+  test_lib::assert_equal(kv.get(std::string{"missing"}).has_value(), false);
+
+  constexpr generic::HashedStringView accept{"accept"};
+  test_lib::assert_equal(kv.get(accept).value().get(), 2);
+
+  for (int i = 0; i < 32; i += 1) {
+    kv.emplace(std::to_string(i), i);
+  }
+  test_lib::assert_true(kv.is_indexed());
+  test_lib::assert_equal(kv.get("17").value().get(), 17);
+  test_lib::assert_equal(kv.get(accept).value().get(), 2);
+  test_lib::assert_equal(kv.remove("host").value(), 1);
+  test_lib::assert_equal(kv.get("host").has_value(), false);
+}
+
+JOWI_ADD_TEST(split_key_vector_hashed_string_keys) {
+  generic::SplitKeyVector<generic::HashedString<>, int> kv{{"a", 1}, {"b", 2}};
+  test_lib::assert_equal(kv.get("b").value().get(), 2);
+  test_lib::assert_equal(kv.get(generic::HashedStringView{"a"}).value().get(), 1);
+  test_lib::assert_equal(kv.get("c").has_value(), false);
+}
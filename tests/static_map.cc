@@ -0,0 +1,89 @@
+import jowi.test_lib;
+import jowi.generic;
+#include <jowi/test_lib.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace test_lib = jowi::test_lib;
+namespace generic = jowi::generic;
+
+enum class Verb : uint8_t { get, head, post, put, del, connect, options, trace, patch };
+
+constexpr auto verbs = generic::make_static_map<Verb, 8>({
+  {"GET", Verb::get},
+  {"HEAD", Verb::head},
+  {"POST", Verb::post},
+  {"PUT", Verb::put},
+  {"DELETE", Verb::del},
+  {"CONNECT", Verb::connect},
+  {"OPTIONS", Verb::options},
+  {"TRACE", Verb::trace},
+  {"PATCH", Verb::patch},
+});
+
+static_assert(verbs.get("PATCH").value() == Verb::patch);
+static_assert(!verbs.contains("PATCHES"));
+
+JOWI_ADD_TEST(static_map_finds_every_key) {
+  test_lib::assert_equal(verbs.size(), 9);
+  for (const auto &[key, verb] : verbs) {
+    auto found = verbs.get(std::string{std::string_view{key}});
+    test_lib::assert_true(found.has_value());
+    test_lib::assert_true(found->get() == verb);
+  }
+}
+
+JOWI_ADD_TEST(static_map_rejects_unknown_keys) {
+  test_lib::assert_false(verbs.contains("get"));
+  test_lib::assert_false(verbs.contains(""));
+  test_lib::assert_false(verbs.contains("GETS"));
+  test_lib::assert_false(verbs.contains("A VERY LONG HEADER NAME"));
+  test_lib::assert_equal(verbs.find("OPTION"), static_cast<const Verb *>(nullptr));
+}
+
+JOWI_ADD_TEST(static_map_reverse_lookup) {
+  test_lib::assert_equal(verbs.key_of(Verb::del).value(), std::string_view{"DELETE"});
+  test_lib::assert_equal(verbs.key_of(Verb::trace).value(), std::string_view{"TRACE"});
+}
+
+JOWI_ADD_TEST(static_map_with_many_keys) {
+  static constexpr auto headers = generic::make_static_map<int, 24>({
+    {"accept", 0},
+    {"accept-encoding", 1},
+    {"accept-language", 2},
+    {"authorization", 3},
+    {"cache-control", 4},
+    {"connection", 5},
+    {"content-encoding", 6},
+    {"content-length", 7},
+    {"content-type", 8},
+    {"cookie", 9},
+    {"date", 10},
+    {"etag", 11},
+    {"expect", 12},
+    {"expires", 13},
+    {"host", 14},
+    {"if-match", 15},
+    {"if-none-match", 16},
+    {"last-modified", 17},
+    {"location", 18},
+    {"origin", 19},
+    {"range", 20},
+    {"referer", 21},
+    {"server", 22},
+    {"set-cookie", 23},
+    {"transfer-encoding", 24},
+    {"upgrade", 25},
+    {"user-agent", 26},
+    {"vary", 27},
+    {"via", 28},
+    {"www-authenticate", 29},
+  });
+  int index = 0;
+  for (const auto &[key, value] : headers) {
+    test_lib::assert_equal(headers.get(std::string_view{key}).value().get(), index);
+    index += 1;
+  }
+  test_lib::assert_false(headers.contains("x-forwarded-for"));
+}
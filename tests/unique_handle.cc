@@ -0,0 +1,382 @@
+import jowi.test_lib;
+import jowi.generic;
+#include <jowi/test_lib.hpp>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace test_lib = jowi::test_lib;
+namespace generic = jowi::generic;
+
+static std::vector<int> closed;
+
+struct CloseFd {
+  void operator()(int fd) const {
+    closed.push_back(fd);
+  }
+};
+
+struct DeleteInt {
+  void operator()(int *p) const {
+    delete p;
+  }
+};
+
+using Fd = generic::UniqueHandle<int, CloseFd, generic::SentinelHandle<-1>>;
+using IntPtr = generic::UniqueHandle<int *, DeleteInt, generic::SentinelHandle<nullptr>>;
+
+static_assert(sizeof(Fd) == sizeof(int));
+static_assert(sizeof(IntPtr) == sizeof(int *));
+static_assert(std::is_nothrow_move_constructible_v<Fd>);
+static_assert(!std::is_nothrow_move_assignable_v<Fd>);
+
+struct IgnoreFd {
+  void operator()(int) const noexcept {}
+};
+static_assert(std::is_nothrow_move_assignable_v<
+              generic::UniqueHandle<int, IgnoreFd, generic::SentinelHandle<-1>>>);
+static_assert(std::is_nothrow_move_constructible_v<generic::UniqueHandle<int, CloseFd>>);
+
+JOWI_ADD_TEST(unique_handle_optional_destroys_once) {
+  closed.clear();
+  {
+    auto a = generic::UniqueHandle<int, CloseFd>::manage_default(3);
+    auto b = std::move(a);
+    test_lib::assert_false(a.has_value());
+    test_lib::assert_equal(b.get(), 3);
+  }
+  test_lib::assert_equal(closed, std::vector<int>{3});
+}
+
+JOWI_ADD_TEST(unique_handle_optional_get_throws_when_empty) {
+  generic::UniqueHandle<int, CloseFd> empty;
+  bool thrown = false;
+  try {
+    empty.get();
+  } catch (const std::bad_optional_access &) {
+    thrown = true;
+  }
+  test_lib::assert_true(thrown);
+  test_lib::assert_equal(empty.get_or(-5), -5);
+}
+
+JOWI_ADD_TEST(unique_handle_optional_release_throws_when_moved_from) {
+  closed.clear();
+  auto a = generic::UniqueHandle<int, CloseFd>::manage_default(4);
+  auto b = std::move(a);
+  bool thrown = false;
+  try {
+    a.release();
+  } catch (const std::bad_optional_access &) {
+    thrown = true;
+  }
+  test_lib::assert_true(thrown);
+  test_lib::assert_equal(b.release(), 4);
+  test_lib::assert_true(closed.empty());
+}
+
+JOWI_ADD_TEST(unique_handle_sentinel_move_and_assign) {
+  closed.clear();
+  {
+    Fd a = Fd::manage_default(4);
+    Fd b = Fd::manage_default(5);
+    test_lib::assert_true(a.has_value());
+    b = std::move(a);
+    test_lib::assert_equal(closed, std::vector<int>{5});
+    test_lib::assert_false(a.has_value());
+    test_lib::assert_equal(a.get(), -1);
+    test_lib::assert_equal(b.get(), 4);
+  }
+  test_lib::assert_equal(closed, std::vector<int>{5, 4});
+}
+
+JOWI_ADD_TEST(unique_handle_vector_moves_on_growth) {
+  closed.clear();
+  {
+    std::vector<Fd> fds;
+    for (int fd = 0; fd < 100; fd += 1) {
+      fds.emplace_back(Fd::manage_default(fd));
+    }
+    test_lib::assert_true(closed.empty());
+  }
+  test_lib::assert_equal(closed.size(), 100);
+}
+
+JOWI_ADD_TEST(unique_handle_capturing_lambda_destructor) {
+  std::vector<int> released;
+  auto release = [&released](int v) { released.push_back(v); };
+  using Handle = generic::UniqueHandle<int, decltype(release)>;
+  {
+    Handle a = Handle::manage(1, release);
+    Handle b = Handle::manage(2, release);
+    b = std::move(a);
+    test_lib::assert_equal(released, std::vector<int>{2});
+  }
+  test_lib::assert_equal(released, std::vector<int>{2, 1});
+}
+
+JOWI_ADD_TEST(unique_handle_release_gives_up_ownership) {
+  closed.clear();
+  {
+    Fd a = Fd::manage_default(6);
+    test_lib::assert_equal(a.release(), 6);
+    test_lib::assert_false(a.has_value());
+    test_lib::assert_equal(a.release_or(7), 7);
+
+    auto b = generic::UniqueHandle<int, CloseFd>::manage_default(8);
+    test_lib::assert_equal(b.release(), 8);
+  }
+  test_lib::assert_true(closed.empty());
+}
+
+JOWI_ADD_TEST(unique_handle_sentinel_pointer) {
+  IntPtr p = IntPtr::manage_default(new int{9});
+  test_lib::assert_equal(*p.get(), 9);
+  IntPtr q;
+  test_lib::assert_false(q.has_value());
+  q = std::move(p);
+  test_lib::assert_equal(p.get(), nullptr);
+  test_lib::assert_equal(*q.get(), 9);
+}
+
+struct CloseBatch {
+  std::vector<size_t> *batches;
+  void operator()(std::span<int> fds) const {
+    batches->push_back(fds.size());
+    closed.insert(closed.end(), fds.begin(), fds.end());
+  }
+};
+
+static_assert(generic::IsBatchDestructor<CloseBatch, int>);
+static_assert(!generic::IsBatchDestructor<CloseFd, int>);
+
+JOWI_ADD_TEST(handle_reaper_generic_lambda_is_called_per_value) {
+  closed.clear();
+  auto close_any = [](auto fd) {
+    if constexpr (std::same_as<decltype(fd), int>) {
+      closed.push_back(fd);
+    }
+  };
+  static_assert(!generic::IsBatchDestructor<decltype(close_any), int>);
+  generic::HandleReaper<int, decltype(close_any)> reaper{close_any};
+  reaper.defer(1);
+  reaper.defer(2);
+  test_lib::assert_equal(reaper.flush(), 2);
+  test_lib::assert_equal(closed, std::vector<int>{1, 2});
+}
+
+JOWI_ADD_TEST(handle_reaper_flushes_at_quiescent_point) {
+  closed.clear();
+  {
+    generic::HandleReaper<int, CloseFd> reaper;
+    Fd a = Fd::manage_default(1);
+    reaper.reap(std::move(a));
+    reaper.reap(Fd{});
+    reaper.defer(2);
+    test_lib::assert_false(a.has_value());
+    test_lib::assert_true(closed.empty());
+    test_lib::assert_equal(reaper.pending(), 2);
+
+    test_lib::assert_equal(reaper.flush(), 2);
+    test_lib::assert_equal(closed, std::vector<int>{1, 2});
+    reaper.defer(3);
+  }
+  test_lib::assert_equal(closed, std::vector<int>{1, 2, 3});
+}
+
+struct CloseOrThrow {
+  void operator()(int fd) const {
+    if (fd < 0) {
+      closed.push_back(fd);
+      throw std::runtime_error{"close failed"};
+    }
+    closed.push_back(fd);
+  }
+};
+
+JOWI_ADD_TEST(handle_reaper_throwing_destructor_destroys_once) {
+  closed.clear();
+  generic::HandleReaper<int, CloseOrThrow> reaper;
+  reaper.defer(1);
+  reaper.defer(-2);
+  reaper.defer(3);
+  bool thrown = false;
+  try {
+    reaper.flush();
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  test_lib::assert_true(thrown);
+  test_lib::assert_equal(closed, std::vector<int>{1, -2});
+  reaper.defer(4);
+  test_lib::assert_equal(reaper.flush(), 2);
+  test_lib::assert_equal(closed, std::vector<int>{1, -2, 3, 4});
+}
+
+JOWI_ADD_TEST(handle_reaper_batch_destructor) {
+  closed.clear();
+  std::vector<size_t> batches;
+  generic::HandleReaper<int, CloseBatch> reaper{CloseBatch{&batches}};
+  for (int fd = 0; fd < 5; fd += 1) {
+    reaper.defer(fd);
+  }
+  test_lib::assert_equal(reaper.flush(), 5);
+  test_lib::assert_equal(reaper.flush(), 0);
+  test_lib::assert_equal(batches, std::vector<size_t>{5});
+  test_lib::assert_equal(closed, std::vector<int>{0, 1, 2, 3, 4});
+}
+
+JOWI_ADD_TEST(handle_reaper_background_thread) {
+  static std::atomic<int> destroyed{0};
+  struct Count {
+    void operator()(int) const {
+      destroyed.fetch_add(1);
+    }
+  };
+  destroyed = 0;
+  {
+    generic::HandleReaper<int, Count> reaper{Count{}, 8};
+    reaper.run_in_background(std::chrono::milliseconds{1});
+    std::vector<std::jthread> producers;
+    for (int t = 0; t < 4; t += 1) {
+      producers.emplace_back([&]() {
+        for (int i = 0; i < 1000; i += 1) {
+          reaper.defer(i);
+        }
+      });
+    }
+    producers.clear();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (destroyed.load() != 4000 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    test_lib::assert_equal(destroyed.load(), 4000);
+  }
+  test_lib::assert_equal(destroyed.load(), 4000);
+}
+
+JOWI_ADD_TEST(handle_reaper_background_thread_survives_throwing_destructor) {
+  static std::atomic<int> destroyed{0};
+  struct CountOrThrow {
+    void operator()(int v) const {
+      destroyed.fetch_add(1);
+      if (v < 0) {
+        throw std::runtime_error{"close failed"};
+      }
+    }
+  };
+  destroyed = 0;
+  {
+    generic::HandleReaper<int, CountOrThrow> reaper{CountOrThrow{}, 4};
+    reaper.run_in_background(std::chrono::milliseconds{1});
+    for (int i = 0; i < 8; i += 1) {
+      reaper.defer(i % 2 == 0 ? i : -i);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while ((destroyed.load() != 8 || reaper.failed_flushes() != 4) &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    test_lib::assert_equal(destroyed.load(), 8);
+    test_lib::assert_equal(reaper.failed_flushes(), 4);
+    // left for the destructor, which has to get past the throwing values as well.
+    reaper.defer(-1);
+    reaper.defer(2);
+    reaper.defer(-3);
+  }
+  test_lib::assert_equal(destroyed.load(), 11);
+}
+
+struct Buffer {
+  int id;
+};
+static std::atomic<int> buffers_created{0};
+static std::atomic<int> buffers_destroyed{0};
+
+struct MakeBuffer {
+  Buffer operator()() const {
+    return Buffer{buffers_created.fetch_add(1)};
+  }
+};
+struct FreeBuffer {
+  void operator()(Buffer) const {
+    buffers_destroyed.fetch_add(1);
+  }
+};
+using BufferPool = generic::HandlePool<Buffer, MakeBuffer, FreeBuffer>;
+
+JOWI_ADD_TEST(handle_pool_recycles_values) {
+  buffers_created = 0;
+  buffers_destroyed = 0;
+  {
+    BufferPool pool;
+    int id = 0;
+    {
+      auto lease = pool.acquire();
+      id = lease.get().id;
+    }
+    test_lib::assert_equal(buffers_destroyed.load(), 0);
+    {
+      auto lease = pool.acquire();
+      test_lib::assert_equal(lease.get().id, id);
+      auto kept = lease.release();
+      test_lib::assert_equal(kept.id, id);
+    }
+    auto fresh = pool.acquire();
+    test_lib::assert_equal(buffers_created.load(), 2);
+  }
+  test_lib::assert_equal(buffers_destroyed.load(), 1);
+}
+
+JOWI_ADD_TEST(handle_pool_bounds_capacity_and_evicts) {
+  buffers_created = 0;
+  buffers_destroyed = 0;
+  {
+    BufferPool pool{MakeBuffer{}, FreeBuffer{}, 2, std::chrono::milliseconds{0}};
+    {
+      std::vector<BufferPool::Lease> leases;
+      for (int i = 0; i < 20; i += 1) {
+        leases.emplace_back(pool.acquire());
+      }
+    }
+    test_lib::assert_true(pool.idle_count() <= 2);
+    test_lib::assert_true(buffers_destroyed.load() > 0);
+    pool.evict_idle();
+    test_lib::assert_equal(pool.idle_count(), 0);
+    test_lib::assert_true(
+      buffers_created.load() - buffers_destroyed.load() <= static_cast<int>(BufferPool::cache_size)
+    );
+  }
+  test_lib::assert_equal(buffers_destroyed.load(), 20);
+}
+
+JOWI_ADD_TEST(handle_pool_concurrent_leases) {
+  buffers_created = 0;
+  buffers_destroyed = 0;
+  {
+    BufferPool pool{MakeBuffer{}, FreeBuffer{}, 16};
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < 4; t += 1) {
+      threads.emplace_back([&]() {
+        std::vector<BufferPool::Lease> leases;
+        for (int i = 0; i < 1000; i += 1) {
+          leases.emplace_back(pool.acquire());
+          if (leases.size() == 12) {
+            leases.clear();
+          }
+        }
+      });
+    }
+    threads.clear();
+    test_lib::assert_true(buffers_created.load() < 4000);
+  }
+  test_lib::assert_equal(buffers_destroyed.load(), buffers_created.load());
+}
@@ -1,7 +1,16 @@
 import jowi.test_lib;
 import jowi.generic;
 #include <jowi/test_lib.hpp>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ranges>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
 namespace test_lib = jowi::test_lib;
@@ -93,6 +102,65 @@ JOWI_ADD_TEST(variant_emplace_functionality) {
   test_lib::assert_equal(v.as<double>()->get(), 3.14);
 }
 
+struct ThrowingInt {
+  int value;
+  ThrowingInt(int v) : value{v} {}
+};
+
+static_assert(noexcept(std::declval<generic::Variant<int, double> &>().emplace<int>(1)));
+static_assert(
+  !noexcept(std::declval<generic::Variant<int, ThrowingInt> &>().emplace<ThrowingInt>(1))
+);
+
+JOWI_ADD_TEST(variant_assign_reuses_held_value) {
+  generic::Variant<int, std::string> v{std::string(64, 'x')};
+  const char *buffer = v.as<std::string>()->get().data();
+
+  std::string replacement{"short"};
+  v.assign(replacement);
+  test_lib::assert_equal(v.as<std::string>()->get(), "short");
+  test_lib::assert_equal(v.as<std::string>()->get().data(), buffer);
+
+  v = std::string{"again"};
+  test_lib::assert_equal(v.as<std::string>()->get(), "again");
+
+  v.emplace_or_assign<std::string>("assigned");
+  test_lib::assert_equal(v.as<std::string>()->get().data(), buffer);
+  v.emplace_or_assign<std::string>(3, 'y');
+  test_lib::assert_equal(v.as<std::string>()->get(), "yyy");
+
+  v.assign(5);
+  test_lib::assert_equal(v.as<int>()->get(), 5);
+  v.emplace_or_assign<std::string>("back");
+  test_lib::assert_equal(v.as<std::string>()->get(), "back");
+}
+
+JOWI_ADD_TEST(variant_converting_move) {
+  generic::Variant<int, std::string> narrow{std::string(64, 'x')};
+  const char *buffer = narrow.as<std::string>()->get().data();
+
+  generic::Variant<double, std::string, int> wide{std::move(narrow)};
+  test_lib::assert_equal(wide.index(), 1);
+  test_lib::assert_equal(wide.as<std::string>()->get().data(), buffer);
+
+  generic::Variant<int, std::string> back{std::move(wide)};
+  test_lib::assert_equal(back.as<std::string>()->get().data(), buffer);
+
+  generic::Variant<double, std::string, int> holds_double{1.5};
+  bool thrown = false;
+  try {
+    generic::Variant<int, std::string> failed{std::move(holds_double)};
+  } catch (const std::bad_variant_access &) {
+    thrown = true;
+  }
+  test_lib::assert_true(thrown);
+
+  back = generic::Variant<double, std::string, int>{7};
+  test_lib::assert_equal(back.as<int>()->get(), 7);
+  wide = generic::Variant<int, std::string>{std::string{"moved"}};
+  test_lib::assert_equal(wide.as<std::string>()->get(), "moved");
+}
+
 JOWI_ADD_TEST(variant_visit_single_function) {
   generic::Variant<int, std::string, double> v{42};
 
@@ -146,4 +214,224 @@ JOWI_ADD_TEST(variant_visit_rvalue_version) {
     [](std::string &&s) { /* handle string rvalue */ },
     [](double &&d) { /* handle double rvalue */ }
   );
-}
\ No newline at end of file
+}
+JOWI_ADD_TEST(variant_visit_rvalue_moves_alternative) {
+  generic::Variant<int, std::string> v{std::string("moved out")};
+  std::string target = std::move(v).visit(
+    [](int &&i) { return std::to_string(i); }, [](std::string &&s) { return std::move(s); }
+  );
+  test_lib::assert_equal(target, std::string("moved out"));
+}
+
+JOWI_ADD_TEST(variant_visit_returns_reference_as_value) {
+  generic::Variant<int, double> v{2.5};
+  double result = v.visit([](auto &value) -> double { return value * 2; });
+  test_lib::assert_equal(result, 5.0);
+  v = 7;
+  test_lib::assert_equal(v.visit([](auto &value) -> double { return value * 2; }), 14.0);
+}
+
+template <size_t I> struct Alternative {
+  size_t value;
+};
+
+template <size_t... Is>
+using WideVariant = generic::Variant<Alternative<Is>...>;
+
+template <size_t... Is> void check_every_alternative(std::index_sequence<Is...>) {
+  (
+    [] {
+      WideVariant<Is...> v{Alternative<Is>{Is * 10}};
+      size_t index = v.visit([]<size_t I>(Alternative<I> &a) { return I + a.value; });
+      test_lib::assert_equal(index, Is * 11);
+      test_lib::assert_true(v.template as<Alternative<Is>>().has_value());
+    }(),
+    ...
+  );
+}
+
+JOWI_ADD_TEST(variant_visit_every_alternative_up_to_switch_limit) {
+  check_every_alternative(std::make_index_sequence<generic::variant_switch_limit>{});
+}
+
+JOWI_ADD_TEST(variant_visit_falls_back_past_switch_limit) {
+  check_every_alternative(std::make_index_sequence<generic::variant_switch_limit + 1>{});
+}
+
+struct PaddedAlternative {
+  int64_t value;
+  char tag;
+};
+
+static_assert(sizeof(generic::CompactVariant<uint32_t, uint16_t>) == sizeof(uint64_t));
+// the index follows the union instead of reusing the tail padding of PaddedAlternative.
+static_assert(
+  sizeof(generic::CompactVariant<PaddedAlternative, int>) ==
+  sizeof(PaddedAlternative) + alignof(PaddedAlternative)
+);
+static_assert(sizeof(generic::CompactVariant<char, uint16_t>) == 2 * sizeof(uint16_t));
+static_assert(sizeof(generic::PointerVariant<int *, double *>) == sizeof(void *));
+static_assert(sizeof(generic::PointerVariant<std::monostate, int *, double *>) == sizeof(void *));
+// pointers stored in a CompactVariant are objects, as returns a reference to them.
+static_assert(std::same_as<
+              decltype(std::declval<generic::CompactVariant<int *, double *> &>().as<int *>()),
+              std::optional<std::reference_wrapper<int *>>>);
+static_assert(std::is_trivially_copyable_v<generic::CompactVariant<int, float, char>>);
+static_assert(!std::is_trivially_copyable_v<generic::CompactVariant<int, std::string>>);
+
+JOWI_ADD_TEST(compact_variant_is_as_visit) {
+  generic::CompactVariant<int, std::string, double> v{42};
+  test_lib::assert_equal(v.index(), 0);
+  test_lib::assert_true(v.is<int>());
+  test_lib::assert_equal(v.as<int>()->get(), 42);
+  test_lib::assert_false(v.as<std::string>().has_value());
+
+  v = std::string{"hello"};
+  test_lib::assert_true(v.is<std::string>());
+  v.as<std::string>()->get() += " world";
+  test_lib::assert_equal(
+    v.visit([](const std::string &s) { return s.length(); }, [](auto) { return size_t{0}; }), 11
+  );
+
+  v.emplace<double>(2.5);
+  test_lib::assert_equal(v.index(), 2);
+  test_lib::assert_equal(
+    v.visit([](double d) { return d * 2; }, [](const auto &) { return 0.0; }), 5.0
+  );
+}
+
+JOWI_ADD_TEST(compact_variant_selects_alternatives_like_std_variant) {
+  generic::CompactVariant<std::string, bool> s{"abc"};
+  generic::Variant<std::string, bool> expected_s{"abc"};
+  test_lib::assert_equal(s.index(), expected_s.index());
+  test_lib::assert_true(s.is<std::string>());
+
+  generic::CompactVariant<long, float> l{1};
+  test_lib::assert_equal(l.index(), static_cast<int>(std::variant<long, float>{1}.index()));
+  generic::CompactVariant<int, double> d{2.5f};
+  test_lib::assert_equal(d.index(), static_cast<int>(std::variant<int, double>{2.5f}.index()));
+  d = 3;
+  test_lib::assert_true(d.is<int>());
+
+  generic::CompactVariant<long, int> p{short{4}};
+  test_lib::assert_equal(p.index(), static_cast<int>(std::variant<long, int>{short{4}}.index()));
+
+  // narrowing conversions select nothing, ambiguous ones neither, like std::variant.
+  static_assert(!std::constructible_from<generic::CompactVariant<int, float>, double>);
+  static_assert(!std::constructible_from<std::variant<int, float>, double>);
+  static_assert(!std::constructible_from<generic::CompactVariant<long, long long>, int>);
+  static_assert(!std::constructible_from<std::variant<long, long long>, int>);
+}
+
+JOWI_ADD_TEST(compact_variant_copy_and_move) {
+  generic::CompactVariant<int, std::string> a{std::string(64, 'x')};
+  generic::CompactVariant<int, std::string> b{a};
+  test_lib::assert_equal(b.as<std::string>()->get(), std::string(64, 'x'));
+
+  generic::CompactVariant<int, std::string> c{std::move(b)};
+  test_lib::assert_equal(c.as<std::string>()->get().length(), 64);
+
+  c = 7;
+  test_lib::assert_equal(c.as<int>()->get(), 7);
+  c = a;
+  test_lib::assert_true(c.is<std::string>());
+  a = generic::CompactVariant<int, std::string>{3};
+  test_lib::assert_equal(a.as<int>()->get(), 3);
+  test_lib::assert_equal(
+    std::move(c).visit(
+      [](std::string &&s) { return std::move(s); }, [](int) { return std::string{}; }
+    ),
+    std::string(64, 'x')
+  );
+}
+
+JOWI_ADD_TEST(pointer_variant_packs_pointers) {
+  int i = 5;
+  double d = 1.5;
+  generic::PointerVariant<std::monostate, int *, double *> v;
+  test_lib::assert_true(v.is<std::monostate>());
+
+  v = &i;
+  test_lib::assert_true(v.is<int *>());
+  test_lib::assert_equal(*v.as<int *>().value(), 5);
+  test_lib::assert_false(v.as<double *>().has_value());
+
+  v = &d;
+  test_lib::assert_equal(v.index(), 2);
+  test_lib::assert_equal(v.as<double *>().value(), &d);
+  double seen = v.visit([](double *p) { return *p; }, [](auto) { return 0.0; });
+  test_lib::assert_equal(seen, 1.5);
+}
+
+static_assert(std::ranges::forward_range<generic::VariantVector<int, std::string>>);
+static_assert(std::ranges::forward_range<const generic::VariantVector<int, std::string>>);
+
+JOWI_ADD_TEST(variant_vector_visit_all_groups_by_alternative) {
+  generic::VariantVector<int, std::string, double> events;
+  events.push_back(1);
+  events.push_back(std::string{"a"});
+  events.push_back(2.5);
+  events.push_back(2);
+  events.emplace_back<std::string>(3, 'b');
+  test_lib::assert_equal(events.size(), 5);
+  test_lib::assert_equal(events.count<int>(), 2);
+  test_lib::assert_equal(events.count<std::string>(), 2);
+
+  int int_sum = 0;
+  std::string text;
+  std::vector<int> seen;
+  events.visit_all(
+    [&](int &v) {
+      int_sum += v;
+      v *= 10;
+      seen.push_back(0);
+    },
+    [&](const std::string &v) {
+      text += v;
+      seen.push_back(1);
+    },
+    [&](double) { seen.push_back(2); }
+  );
+  test_lib::assert_equal(int_sum, 3);
+  test_lib::assert_equal(text, "abbb");
+  test_lib::assert_equal(seen, std::vector<int>{0, 0, 1, 1, 2});
+  test_lib::assert_equal(events.column<int>()[1], 20);
+}
+
+JOWI_ADD_TEST(variant_vector_iterates_in_insertion_order) {
+  generic::VariantVector<int, std::string> events;
+  events.push_back(generic::Variant<int, std::string>{std::string{"first"}});
+  events.push_back(7);
+  events.push_back(std::string{"third"});
+
+  std::vector<int> indexes;
+  for (auto event : events) {
+    indexes.push_back(event.index());
+  }
+  test_lib::assert_equal(indexes, std::vector<int>{1, 0, 1});
+
+  auto it = events.begin();
+  test_lib::assert_true((*it).is<std::string>());
+  test_lib::assert_false((*it).is<int>());
+  test_lib::assert_equal((*it).as<std::string>()->get(), "first");
+  ++it;
+  (*it).as<int>()->get() += 1;
+  test_lib::assert_equal(events.column<int>()[0], 8);
+  ++it;
+  test_lib::assert_equal((*it).visit([](const std::string &s) { return s.length(); }, [](int) {
+    return size_t{0};
+  }), 5);
+
+  const auto &view = events;
+  size_t length = 0;
+  for (auto event : view) {
+    length += event.visit([](const std::string &s) { return s.length(); }, [](const int &) {
+      return size_t{1};
+    });
+  }
+  test_lib::assert_equal(length, 11);
+
+  events.clear();
+  test_lib::assert_true(events.empty());
+  test_lib::assert_equal(events.count<std::string>(), 0);
+}